@@ -0,0 +1,259 @@
+#ifndef CODELIBRARY_H
+#define CODELIBRARY_H
+
+#include <IRremoteESP8266.h>
+
+// Built-in library of common device codes. Everything here lives in flash:
+// entries are read with memcpy_P and names with the *_P string functions.
+// Codes must stay grouped by brand, in the same order as LibraryBrand, so the
+// brand index below can be computed at compile time. The device index is
+// computed the same way and does not depend on the order.
+
+enum LibraryBrand : uint8_t {
+  BRAND_EPSON,
+  BRAND_LG,
+  BRAND_MIDEA,
+  BRAND_PANASONIC,
+  BRAND_PHILIPS,
+  BRAND_SAMSUNG,
+  BRAND_SONY,
+  BRAND_SPRINGER,
+  BRAND_TOSHIBA,
+  BRAND_YAMAHA,
+  LIBRARY_BRAND_COUNT
+};
+
+enum LibraryDevice : uint8_t {
+  DEVICE_TV,
+  DEVICE_SOUNDBAR,
+  DEVICE_PROJECTOR,
+  DEVICE_AC,
+  LIBRARY_DEVICE_COUNT
+};
+
+enum LibraryFunction : uint8_t {
+  FUNCTION_POWER,
+  FUNCTION_POWER_ON,
+  FUNCTION_POWER_OFF,
+  FUNCTION_VOLUME_UP,
+  FUNCTION_VOLUME_DOWN,
+  FUNCTION_MUTE,
+  FUNCTION_CHANNEL_UP,
+  FUNCTION_CHANNEL_DOWN,
+  FUNCTION_INPUT,
+  FUNCTION_UP,
+  FUNCTION_DOWN,
+  FUNCTION_LEFT,
+  FUNCTION_RIGHT,
+  FUNCTION_OK,
+  FUNCTION_BACK,
+  FUNCTION_HOME,
+  FUNCTION_MENU,
+  FUNCTION_SWING,
+  FUNCTION_TURBO,
+  FUNCTION_SLEEP,
+  FUNCTION_LIGHT,
+  FUNCTION_CLEAN,
+  LIBRARY_FUNCTION_COUNT
+};
+
+#define LIBRARY_NAME_LENGTH 12
+
+const char LIBRARY_BRAND_NAMES[LIBRARY_BRAND_COUNT][LIBRARY_NAME_LENGTH] PROGMEM = {
+  "Epson", "LG", "Midea", "Panasonic", "Philips",
+  "Samsung", "Sony", "Springer", "Toshiba", "Yamaha"
+};
+
+const char LIBRARY_DEVICE_NAMES[LIBRARY_DEVICE_COUNT][LIBRARY_NAME_LENGTH] PROGMEM = {
+  "tv", "soundbar", "projector", "ac"
+};
+
+// Also used as the default button name when a code is added to a remote
+const char LIBRARY_FUNCTION_NAMES[LIBRARY_FUNCTION_COUNT][LIBRARY_NAME_LENGTH] PROGMEM = {
+  "Power", "Power On", "Power Off", "Volume +", "Volume -", "Mudo",
+  "Canal +", "Canal -", "Entrada", "Cima", "Baixo", "Esquerda",
+  "Direita", "OK", "Voltar", "Home", "Menu", "Swing",
+  "Turbo", "Sleep", "Luz", "Limpeza"
+};
+
+struct LibraryCode {
+  uint8_t brand;    // LibraryBrand
+  uint8_t device;   // LibraryDevice
+  uint8_t function; // LibraryFunction
+  uint8_t protocol; // decode_type_t
+  uint8_t bits;
+  uint64_t value;
+};
+
+constexpr LibraryCode LIBRARY_CODES[] PROGMEM = {
+  // Epson
+  {BRAND_EPSON, DEVICE_PROJECTOR, FUNCTION_POWER, NEC, 32, 0xC1AA09F6},
+
+  // LG
+  {BRAND_LG, DEVICE_TV, FUNCTION_POWER, NEC, 32, 0x20DF10EF},
+  {BRAND_LG, DEVICE_TV, FUNCTION_POWER_ON, NEC, 32, 0x20DF23DC},
+  {BRAND_LG, DEVICE_TV, FUNCTION_POWER_OFF, NEC, 32, 0x20DFA35C},
+  {BRAND_LG, DEVICE_TV, FUNCTION_VOLUME_UP, NEC, 32, 0x20DF40BF},
+  {BRAND_LG, DEVICE_TV, FUNCTION_VOLUME_DOWN, NEC, 32, 0x20DFC03F},
+  {BRAND_LG, DEVICE_TV, FUNCTION_MUTE, NEC, 32, 0x20DF906F},
+  {BRAND_LG, DEVICE_TV, FUNCTION_CHANNEL_UP, NEC, 32, 0x20DF00FF},
+  {BRAND_LG, DEVICE_TV, FUNCTION_CHANNEL_DOWN, NEC, 32, 0x20DF807F},
+  {BRAND_LG, DEVICE_TV, FUNCTION_INPUT, NEC, 32, 0x20DFD02F},
+  {BRAND_LG, DEVICE_TV, FUNCTION_UP, NEC, 32, 0x20DF02FD},
+  {BRAND_LG, DEVICE_TV, FUNCTION_DOWN, NEC, 32, 0x20DF827D},
+  {BRAND_LG, DEVICE_TV, FUNCTION_LEFT, NEC, 32, 0x20DFE01F},
+  {BRAND_LG, DEVICE_TV, FUNCTION_RIGHT, NEC, 32, 0x20DF609F},
+  {BRAND_LG, DEVICE_TV, FUNCTION_OK, NEC, 32, 0x20DF22DD},
+  {BRAND_LG, DEVICE_TV, FUNCTION_BACK, NEC, 32, 0x20DF14EB},
+  {BRAND_LG, DEVICE_TV, FUNCTION_HOME, NEC, 32, 0x20DF3EC1},
+  {BRAND_LG, DEVICE_AC, FUNCTION_POWER_OFF, LG2, 28, 0x88C0051},
+  {BRAND_LG, DEVICE_AC, FUNCTION_SWING, LG2, 28, 0x8810001},
+
+  // Midea
+  {BRAND_MIDEA, DEVICE_AC, FUNCTION_POWER_ON, COOLIX, 24, 0xB2BFC8},
+  {BRAND_MIDEA, DEVICE_AC, FUNCTION_POWER_OFF, COOLIX, 24, 0xB27BE0},
+  {BRAND_MIDEA, DEVICE_AC, FUNCTION_SWING, COOLIX, 24, 0xB26BE0},
+  {BRAND_MIDEA, DEVICE_AC, FUNCTION_TURBO, COOLIX, 24, 0xB5F5A2},
+  {BRAND_MIDEA, DEVICE_AC, FUNCTION_SLEEP, COOLIX, 24, 0xB2E003},
+  {BRAND_MIDEA, DEVICE_AC, FUNCTION_LIGHT, COOLIX, 24, 0xB5F5A5},
+  {BRAND_MIDEA, DEVICE_AC, FUNCTION_CLEAN, COOLIX, 24, 0xB5F5AA},
+
+  // Panasonic
+  {BRAND_PANASONIC, DEVICE_TV, FUNCTION_POWER, PANASONIC, 48, 0x40040100BCBD},
+  {BRAND_PANASONIC, DEVICE_TV, FUNCTION_VOLUME_UP, PANASONIC, 48, 0x400401000405},
+  {BRAND_PANASONIC, DEVICE_TV, FUNCTION_VOLUME_DOWN, PANASONIC, 48, 0x400401008485},
+  {BRAND_PANASONIC, DEVICE_TV, FUNCTION_MUTE, PANASONIC, 48, 0x400401004C4D},
+  {BRAND_PANASONIC, DEVICE_TV, FUNCTION_CHANNEL_UP, PANASONIC, 48, 0x400401002C2D},
+  {BRAND_PANASONIC, DEVICE_TV, FUNCTION_CHANNEL_DOWN, PANASONIC, 48, 0x40040100ACAD},
+  {BRAND_PANASONIC, DEVICE_TV, FUNCTION_INPUT, PANASONIC, 48, 0x40040100A0A1},
+
+  // Philips
+  {BRAND_PHILIPS, DEVICE_TV, FUNCTION_POWER, RC5, 12, 0x00C},
+  {BRAND_PHILIPS, DEVICE_TV, FUNCTION_VOLUME_UP, RC5, 12, 0x010},
+  {BRAND_PHILIPS, DEVICE_TV, FUNCTION_VOLUME_DOWN, RC5, 12, 0x011},
+  {BRAND_PHILIPS, DEVICE_TV, FUNCTION_MUTE, RC5, 12, 0x00D},
+  {BRAND_PHILIPS, DEVICE_TV, FUNCTION_CHANNEL_UP, RC5, 12, 0x020},
+  {BRAND_PHILIPS, DEVICE_TV, FUNCTION_CHANNEL_DOWN, RC5, 12, 0x021},
+
+  // Samsung
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_POWER, SAMSUNG, 32, 0xE0E040BF},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_POWER_ON, SAMSUNG, 32, 0xE0E09966},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_POWER_OFF, SAMSUNG, 32, 0xE0E019E6},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_VOLUME_UP, SAMSUNG, 32, 0xE0E0E01F},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_VOLUME_DOWN, SAMSUNG, 32, 0xE0E0D02F},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_MUTE, SAMSUNG, 32, 0xE0E0F00F},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_CHANNEL_UP, SAMSUNG, 32, 0xE0E048B7},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_CHANNEL_DOWN, SAMSUNG, 32, 0xE0E008F7},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_INPUT, SAMSUNG, 32, 0xE0E0807F},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_UP, SAMSUNG, 32, 0xE0E006F9},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_DOWN, SAMSUNG, 32, 0xE0E08679},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_LEFT, SAMSUNG, 32, 0xE0E0A659},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_RIGHT, SAMSUNG, 32, 0xE0E046B9},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_OK, SAMSUNG, 32, 0xE0E016E9},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_BACK, SAMSUNG, 32, 0xE0E01AE5},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_HOME, SAMSUNG, 32, 0xE0E09E61},
+  {BRAND_SAMSUNG, DEVICE_TV, FUNCTION_MENU, SAMSUNG, 32, 0xE0E058A7},
+
+  // Sony
+  {BRAND_SONY, DEVICE_TV, FUNCTION_POWER, SONY, 12, 0xA90},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_POWER_ON, SONY, 12, 0x750},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_POWER_OFF, SONY, 12, 0xF50},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_VOLUME_UP, SONY, 12, 0x490},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_VOLUME_DOWN, SONY, 12, 0xC90},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_MUTE, SONY, 12, 0x290},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_CHANNEL_UP, SONY, 12, 0x090},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_CHANNEL_DOWN, SONY, 12, 0x890},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_INPUT, SONY, 12, 0xA50},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_UP, SONY, 12, 0x2F0},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_DOWN, SONY, 12, 0xAF0},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_LEFT, SONY, 12, 0x2D0},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_RIGHT, SONY, 12, 0xCD0},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_OK, SONY, 12, 0xA70},
+  {BRAND_SONY, DEVICE_TV, FUNCTION_HOME, SONY, 12, 0x070},
+  {BRAND_SONY, DEVICE_SOUNDBAR, FUNCTION_POWER, SONY, 12, 0xA81},
+  {BRAND_SONY, DEVICE_SOUNDBAR, FUNCTION_VOLUME_UP, SONY, 12, 0x481},
+  {BRAND_SONY, DEVICE_SOUNDBAR, FUNCTION_VOLUME_DOWN, SONY, 12, 0xC81},
+  {BRAND_SONY, DEVICE_SOUNDBAR, FUNCTION_MUTE, SONY, 12, 0x281},
+
+  // Springer (same protocol family as Midea)
+  {BRAND_SPRINGER, DEVICE_AC, FUNCTION_POWER_ON, COOLIX, 24, 0xB2BFC8},
+  {BRAND_SPRINGER, DEVICE_AC, FUNCTION_POWER_OFF, COOLIX, 24, 0xB27BE0},
+  {BRAND_SPRINGER, DEVICE_AC, FUNCTION_SWING, COOLIX, 24, 0xB26BE0},
+  {BRAND_SPRINGER, DEVICE_AC, FUNCTION_TURBO, COOLIX, 24, 0xB5F5A2},
+  {BRAND_SPRINGER, DEVICE_AC, FUNCTION_SLEEP, COOLIX, 24, 0xB2E003},
+  {BRAND_SPRINGER, DEVICE_AC, FUNCTION_LIGHT, COOLIX, 24, 0xB5F5A5},
+
+  // Toshiba
+  {BRAND_TOSHIBA, DEVICE_TV, FUNCTION_POWER, NEC, 32, 0x02FD48B7},
+  {BRAND_TOSHIBA, DEVICE_TV, FUNCTION_VOLUME_UP, NEC, 32, 0x02FD58A7},
+  {BRAND_TOSHIBA, DEVICE_TV, FUNCTION_VOLUME_DOWN, NEC, 32, 0x02FD7887},
+  {BRAND_TOSHIBA, DEVICE_TV, FUNCTION_MUTE, NEC, 32, 0x02FD08F7},
+  {BRAND_TOSHIBA, DEVICE_TV, FUNCTION_CHANNEL_UP, NEC, 32, 0x02FDD827},
+  {BRAND_TOSHIBA, DEVICE_TV, FUNCTION_CHANNEL_DOWN, NEC, 32, 0x02FDF807},
+  {BRAND_TOSHIBA, DEVICE_TV, FUNCTION_INPUT, NEC, 32, 0x02FDF00F},
+
+  // Yamaha
+  {BRAND_YAMAHA, DEVICE_SOUNDBAR, FUNCTION_POWER, NEC, 32, 0x5EA1F807},
+  {BRAND_YAMAHA, DEVICE_SOUNDBAR, FUNCTION_VOLUME_UP, NEC, 32, 0x5EA158A7},
+  {BRAND_YAMAHA, DEVICE_SOUNDBAR, FUNCTION_VOLUME_DOWN, NEC, 32, 0x5EA1D827},
+  {BRAND_YAMAHA, DEVICE_SOUNDBAR, FUNCTION_MUTE, NEC, 32, 0x5EA138C7},
+};
+
+constexpr uint16_t LIBRARY_CODE_COUNT = sizeof(LIBRARY_CODES) / sizeof(LIBRARY_CODES[0]);
+
+// Index of the first code of each brand; codes of brand b are in
+// [start[b], start[b + 1])
+struct LibraryBrandIndex {
+  uint16_t start[LIBRARY_BRAND_COUNT + 1];
+};
+
+constexpr LibraryBrandIndex buildLibraryBrandIndex() {
+  LibraryBrandIndex index = {};
+  uint16_t code = 0;
+  for (uint8_t brand = 0; brand <= LIBRARY_BRAND_COUNT; brand++) {
+    while (code < LIBRARY_CODE_COUNT && LIBRARY_CODES[code].brand < brand) code++;
+    index.start[brand] = code;
+  }
+  return index;
+}
+
+constexpr bool libraryCodesAreGroupedByBrand() {
+  for (uint16_t i = 1; i < LIBRARY_CODE_COUNT; i++) {
+    if (LIBRARY_CODES[i].brand < LIBRARY_CODES[i - 1].brand) return false;
+  }
+  return true;
+}
+
+static_assert(libraryCodesAreGroupedByBrand(), "LIBRARY_CODES must be grouped by brand in LibraryBrand order");
+
+constexpr LibraryBrandIndex LIBRARY_BRAND_INDEX PROGMEM = buildLibraryBrandIndex();
+
+// Codes of each device, by id in table order; the codes of device d are
+// codes[start[d]] .. codes[start[d + 1] - 1]
+struct LibraryDeviceIndex {
+  uint16_t start[LIBRARY_DEVICE_COUNT + 1];
+  uint16_t codes[LIBRARY_CODE_COUNT];
+};
+
+constexpr LibraryDeviceIndex buildLibraryDeviceIndex() {
+  LibraryDeviceIndex index = {};
+  uint16_t next = 0;
+  for (uint8_t device = 0; device < LIBRARY_DEVICE_COUNT; device++) {
+    index.start[device] = next;
+    for (uint16_t code = 0; code < LIBRARY_CODE_COUNT; code++) {
+      if (LIBRARY_CODES[code].device == device) index.codes[next++] = code;
+    }
+  }
+  index.start[LIBRARY_DEVICE_COUNT] = next;
+  return index;
+}
+
+static_assert(buildLibraryDeviceIndex().start[LIBRARY_DEVICE_COUNT] == LIBRARY_CODE_COUNT,
+              "Every code in LIBRARY_CODES needs a LibraryDevice");
+
+constexpr LibraryDeviceIndex LIBRARY_DEVICE_INDEX PROGMEM = buildLibraryDeviceIndex();
+
+// Searches match functions through a bitmask of LibraryFunction ids
+static_assert(LIBRARY_FUNCTION_COUNT <= 32, "LibraryFunction ids must fit a uint32_t mask");
+
+#endif
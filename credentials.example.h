@@ -5,4 +5,11 @@
 // #define WIFI_SSID "Your_SSID_Here"
 // #define WIFI_PASSWD "Your_Password_Here"
 
+// // Optional: fleet name and room of this board
+// #define NODE_NAME "ir-remote-sala"
+// #define FLEET_ROOM "sala"
+
+// // Optional: one IR emitter pin per channel (default: D2 only)
+// #define IR_CHANNEL_PINS GPIO_D2, GPIO_D1
+
 // #endif
@@ -8,32 +8,114 @@
 #include <ESP8266mDNS.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <time.h>
+#include <new>
 #include "credentials.h"
 #include "webinterface.h"
+#include "codelibrary.h"
 
 // Pin definitions
+#define GPIO_D1 5
 #define GPIO_D2 4
 #define GPIO_D5 14
 #define IR_RECEIVER_PIN GPIO_D5
 #define IR_LED_PIN GPIO_D2
+// One emitter per channel. Boards with more IR LEDs list their pins in
+// credentials.h, e.g. #define IR_CHANNEL_PINS GPIO_D2, GPIO_D1
+#ifndef IR_CHANNEL_PINS
+#define IR_CHANNEL_PINS IR_LED_PIN
+#endif
 #define SERIAL_BAUD_RATE 115200
+#define SERIAL_COMMAND_MAX_LENGTH 128
+#define SERIAL_REPLY_CHUNK 64 // JSON bytes per reply line; a line fits the 128-byte UART FIFO
+
+// Network settings
+#define WIFI_CONNECT_TIMEOUT_MS 15000 // Boot carries on without network after this
+#define TIMEZONE "<-03>3" // POSIX TZ string, Brasilia time
+#define NTP_SERVER_1 "a.st1.ntp.br"
+#define NTP_SERVER_2 "pool.ntp.org"
+
+// Fleet settings (NODE_NAME and FLEET_ROOM may be set in credentials.h)
+#ifndef FLEET_ROOM
+#define FLEET_ROOM ""
+#endif
+#define FLEET_SERVICE "irremote"
+#define MAX_FLEET_PEERS 16
+#define FLEET_TIMEOUT_MS 800
+#define FLEET_CONNECT_TIMEOUT_MS 250 // Peers are on the LAN; a slower connect means the peer is gone
+#define FLEET_RETRY_MS 60000 // A peer that could not be connected to is skipped for this long
 
 // IR settings
 #define CAPTURE_BUFFER_SIZE 1024
 #define MESSAGE_END_TIMEOUT 50
 #define IR_LED_FREQUENCY 38000
 
+// Fingerprint settings
+#define FINGERPRINT_INDEX_SIZE 256 // Power of two, larger than MAX_REMOTES * MAX_BUTTONS_PER_REMOTE
+#define FINGERPRINT_MIN_LENGTH 6
+#define FNV_OFFSET_BASIS_32 2166136261UL
+#define FNV_PRIME_32 16777619UL
+
+// Code library settings
+#define LIBRARY_SEARCH_LIMIT 32
+
+// Storage
+#define DATA_PATH "/remotes.ndjson"
+#define DATA_TEMP_PATH "/remotes.ndjson.tmp"
+#define LEGACY_DATA_PATH "/remotes.json"
+#define RESTORE_TEMP_PATH "/restore.tmp"
+#define BACKUP_VERSION 1
+#define BACKUP_CHUNK_SIZE 512
+#define SCHEDULES_PATH "/schedules.json"
+#define SCHEDULES_TEMP_PATH "/schedules.json.tmp"
+#define RECORD_MAX_LENGTH 384 // Longest stored record line, timing arrays excluded
+
+// Deferred work settings
+#define SAVE_DELAY_MS 500 // Edits arriving within this window share one flash write
+#define SAVE_QUIET_MS 300 // Flash writes wait this long after the last transmission...
+#define SAVE_MAX_DELAY_MS 5000 // ...but never longer than this
+#define TX_QUEUE_SIZE 16
+#define TX_FRAME_GAP_MS 50
+#define MAX_MACRO_DELAY_MS 10000
+
+// Hold-to-repeat settings
+#define HOLD_LEASE_MS 400 // A hold ends unless the browser renews it within this time
+#define HOLD_MAX_MS 30000 // ...and in any case after this long
+#define NEC_REPEAT_PERIOD_MS 108
+#define HOLD_LIBRARY_PERIOD_MS 110 // Library codes other than NEC have no capture to measure
+
+// Request lanes
+#define LANE_REALTIME 0 // IR sends, macros and the short controls a user waits on
+#define LANE_MANAGEMENT 1 // Everything that reads or edits the registry
+#define LANE_COUNT 2
+#define LANE_SHED_LATE_MS 10 // A frame ready this long means loop() is behind; management requests get 503
+
+// Scheduler settings
+#define MAX_SCHEDULES 128
+#define MAX_SCHEDULE_STEPS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS) // Per level; a level covers 64 times the span of the one below
+#define WHEEL_LEVELS 3 // One-minute ticks, so the wheel spans 64^3 minutes (~182 days)
+#define WHEEL_MAX_CATCH_UP_MINUTES 60 // Larger clock jumps rebuild the wheel instead of replaying it
+#define CLOCK_VALID_AFTER 1600000000UL // Any earlier time means NTP has not synced yet
+
 // Limits
 #define MAX_REMOTES 10
 #define MAX_BUTTONS_PER_REMOTE 20
 #define MAX_NAME_LENGTH 30
+#define REQUEST_BODY_MAX_LENGTH 1024 // ArduinoJson 7 documents grow with their input
 
 // Data structures
+// One per button slot, so kept to a pointer and one word: captures never
+// exceed CAPTURE_BUFFER_SIZE, which leaves length a spare bit for isValid
 struct IRSignal {
   uint16_t* data;
-  uint16_t length;
-  bool isValid;
+  uint16_t length : 15;
+  bool isValid : 1;
+  int16_t libraryCode; // Index into LIBRARY_CODES, -1 for raw captures
 };
+static_assert(CAPTURE_BUFFER_SIZE < (1 << 15), "Capture lengths must fit IRSignal::length");
+static_assert(sizeof(IRSignal) <= 2 * sizeof(uint16_t*), "IRSignal is stored in every button slot");
 
 struct Button {
   char name[MAX_NAME_LENGTH];
@@ -45,13 +127,105 @@ struct Remote {
   char name[MAX_NAME_LENGTH];
   Button buttons[MAX_BUTTONS_PER_REMOTE];
   int buttonCount;
+  uint8_t channel; // Emitter in sight of the remote's device
+  bool isActive;
+};
+
+struct TransmitJob {
+  int8_t remoteId;
+  int8_t buttonId;
+  uint8_t afterChannel; // Channel of the frame this one follows, usually its own
+  uint32_t afterSequence;
+  uint32_t sequence;
+  uint16_t gapMs; // Minimum time since the previous frame
+  unsigned long queuedAt; // micros()
+};
+
+// One emitter, with its own queue and frame spacing
+struct TransmitChannel {
+  TransmitJob queue[TX_QUEUE_SIZE];
+  uint8_t head;
+  uint8_t count;
+  uint32_t lastSequence; // Last job queued
+  unsigned long lastTransmitAt;
+  uint32_t frames;
+  uint64_t latencySumUs;
+  uint32_t latencyMaxUs;
+};
+
+struct MacroStep {
+  int remoteId;
+  int buttonId;
+  uint16_t delayMs;
+};
+
+// Results shared by the HTTP and serial interfaces
+enum CommandResult {
+  COMMAND_OK,
+  COMMAND_INVALID_ID,
+  COMMAND_NO_SIGNAL,
+  COMMAND_INVALID_STEP,
+  COMMAND_TOO_MANY_STEPS,
+  COMMAND_NO_MATCH,
+  COMMAND_QUEUE_FULL
+};
+
+struct FleetPeer {
+  char name[32];
+  char room[MAX_NAME_LENGTH];
+  IPAddress ip;
+  uint16_t port;
+  uint8_t remotes;
+  uint16_t buttons;
+  unsigned long seenAt;
+  unsigned long failedAt;
+  bool isUnreachable; // Skipped by fan-outs until FLEET_RETRY_MS after failedAt
+  bool isActive;
+};
+
+enum ScheduleType : uint8_t {
+  SCHEDULE_ONCE,
+  SCHEDULE_DAILY,
+  SCHEDULE_WEEKLY
+};
+
+struct ScheduleStep {
+  int8_t remoteId;
+  int8_t buttonId;
+  uint16_t delayMs;
+};
+
+struct Schedule {
+  uint32_t fireMinute; // Next run, in minutes since the epoch
+  int16_t next; // Next schedule in the same wheel slot, -1 ends the list
+  uint16_t minuteOfDay; // Local time of day for daily and weekly schedules
+  ScheduleType type;
+  uint8_t weekdays; // Bit 0 is Sunday
+  uint8_t stepCount;
   bool isActive;
+  ScheduleStep steps[MAX_SCHEDULE_STEPS];
+};
+
+struct LaneStats {
+  uint32_t requests;
+  uint32_t shed;
+  uint32_t latencySamples;
+  uint64_t latencySumUs;
+  uint32_t latencyMaxUs;
+};
+
+struct FingerprintEntry {
+  uint32_t fingerprint; // 0 marks an empty slot
+  int8_t remoteId;
+  int8_t buttonId;
 };
 
 // Global variables
 Remote remotes[MAX_REMOTES];
 int remoteCount = 0;
-IRsend irsend(IR_LED_PIN);
+constexpr uint8_t IR_CHANNEL_PIN_LIST[] = {IR_CHANNEL_PINS};
+constexpr int IR_CHANNEL_COUNT = sizeof(IR_CHANNEL_PIN_LIST) / sizeof(IR_CHANNEL_PIN_LIST[0]);
+IRsend* irsend[IR_CHANNEL_COUNT]; // Created in setup(), one per pin
 IRrecv irrecv(IR_RECEIVER_PIN, CAPTURE_BUFFER_SIZE, MESSAGE_END_TIMEOUT, false);
 decode_results irReadingResults;
 ESP8266WebServer server(80);
@@ -61,67 +235,668 @@ bool recordingMode = false;
 int recordingRemoteId = -1;
 int recordingButtonId = -1;
 
-// Persistence functions
-void saveData() {
-  Serial.println("Saving data to LittleFS...");
+// Deferred work variables
+TransmitChannel channels[IR_CHANNEL_COUNT];
+uint8_t nextChannel = 0; // Round-robin start
+uint32_t transmitSequence = 0;
+unsigned long lastTransmitAt = 0; // On any channel
+bool saveRequested = false;
+bool schedulesSaveRequested = false;
+unsigned long saveRequestedAt = 0;
+uint32_t saveCount = 0;
+unsigned long lastSaveDurationMs = 0;
+uint32_t flashBytesWritten = 0;
+bool savesBlocked = false; // Stored data exists but could not be loaded
+unsigned long bootLoadMs = 0;
+
+// Hold variables
+int holdRemoteId = -1;
+int holdButtonId = -1;
+unsigned long holdStartedAt = 0;
+unsigned long holdRenewedAt = 0;
+unsigned long holdNextFrameAt = 0;
+unsigned long holdRequestedAtUs = 0;
+uint32_t holdFrames = 0;
+bool holdReleased = false; // Released before its first frame went out
+
+// Request lane variables
+LaneStats laneStats[LANE_COUNT];
+
+// Scheduler variables
+Schedule schedules[MAX_SCHEDULES];
+int16_t wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+uint32_t wheelMinute = 0; // Next minute to be processed
+bool wheelStarted = false;
+uint32_t scheduleFireCount = 0;
+
+// Serial command variables
+char serialCommand[SERIAL_COMMAND_MAX_LENGTH];
+uint8_t serialCommandLength = 0;
+bool serialCommandOverflow = false;
+String serialReplyText; // JSON reply still being written out
+size_t serialReplySent = 0;
+bool mdnsStarted = false;
+
+// Fleet variables
+char nodeName[32];
+FleetPeer fleetPeers[MAX_FLEET_PEERS];
+MDNSResponder::hMDNSService fleetService = nullptr;
+MDNSResponder::hMDNSServiceQuery fleetQuery = nullptr;
+
+// Listen mode variables
+FingerprintEntry fingerprintIndex[FINGERPRINT_INDEX_SIZE];
+bool listenMode = false;
+uint32_t listenFrameCount = 0;
+uint32_t listenMatchCount = 0;
+int lastMatchRemoteId = -1;
+int lastMatchButtonId = -1;
+uint32_t lastMatchFingerprint = 0;
+unsigned long lastMatchAt = 0;
+
+// Fingerprint functions
+// Each mark (or space) is compared with the next mark (or space) and reduced
+// to shorter/similar/longer, which survives the jitter between two captures
+// of the same button. The resulting symbols are hashed with FNV-1a.
+uint32_t fingerprintTimings(const uint16_t* data, uint16_t length) {
+  if (data == nullptr || length < FINGERPRINT_MIN_LENGTH) return 0;
+
+  uint32_t hash = FNV_OFFSET_BASIS_32;
+  for (uint16_t i = 0; i + 2 < length; i++) {
+    uint32_t oldValue = data[i];
+    uint32_t newValue = data[i + 2];
+    uint8_t symbol = 1;
+    if (newValue * 10 < oldValue * 8) {
+      symbol = 0;
+    } else if (newValue * 10 > oldValue * 12) {
+      symbol = 2;
+    }
+    hash = (hash ^ symbol) * FNV_PRIME_32;
+  }
 
-  DynamicJsonDocument doc(16384); // 16KB buffer
-  JsonArray remotesArray = doc.createNestedArray("remotes");
+  return hash == 0 ? 1 : hash; // 0 is reserved for empty index slots
+}
+
+// Decoded frames are keyed by protocol and value instead, which is exact
+uint32_t fingerprintCode(decode_type_t protocol, uint64_t value, uint16_t bits) {
+  uint32_t hash = FNV_OFFSET_BASIS_32;
+  hash = (hash ^ (uint8_t)protocol) * FNV_PRIME_32;
+  hash = (hash ^ (uint8_t)bits) * FNV_PRIME_32;
+  for (int i = 0; i < 8; i++) {
+    hash = (hash ^ (uint8_t)(value >> (8 * i))) * FNV_PRIME_32;
+  }
+
+  return hash == 0 ? 1 : hash;
+}
+
+void insertFingerprint(uint32_t fingerprint, int remoteId, int buttonId) {
+  if (fingerprint == 0) return;
+
+  uint16_t slot = fingerprint & (FINGERPRINT_INDEX_SIZE - 1);
+  for (int probe = 0; probe < FINGERPRINT_INDEX_SIZE; probe++) {
+    FingerprintEntry& entry = fingerprintIndex[slot];
+    if (entry.fingerprint == fingerprint) return; // Keep the first button with this code
+    if (entry.fingerprint == 0) {
+      entry.fingerprint = fingerprint;
+      entry.remoteId = remoteId;
+      entry.buttonId = buttonId;
+      return;
+    }
+    slot = (slot + 1) & (FINGERPRINT_INDEX_SIZE - 1);
+  }
+}
+
+int findFingerprint(uint32_t fingerprint) {
+  if (fingerprint == 0) return -1;
+
+  uint16_t slot = fingerprint & (FINGERPRINT_INDEX_SIZE - 1);
+  for (int probe = 0; probe < FINGERPRINT_INDEX_SIZE; probe++) {
+    if (fingerprintIndex[slot].fingerprint == fingerprint) return slot;
+    if (fingerprintIndex[slot].fingerprint == 0) return -1;
+    slot = (slot + 1) & (FINGERPRINT_INDEX_SIZE - 1);
+  }
+
+  return -1;
+}
+
+// Code library functions
+LibraryCode readLibraryCode(int codeId) {
+  LibraryCode code;
+  memcpy_P(&code, &LIBRARY_CODES[codeId], sizeof(LibraryCode));
+  return code;
+}
+
+int findLibraryBrand(const char* name) {
+  for (int i = 0; i < LIBRARY_BRAND_COUNT; i++) {
+    if (strcasecmp_P(name, LIBRARY_BRAND_NAMES[i]) == 0) return i;
+  }
+  return -1;
+}
+
+int findLibraryDevice(const char* name) {
+  for (int i = 0; i < LIBRARY_DEVICE_COUNT; i++) {
+    if (strcasecmp_P(name, LIBRARY_DEVICE_NAMES[i]) == 0) return i;
+  }
+  return -1;
+}
+
+// The functions whose name contains the query (case-insensitive), as a mask
+// of LibraryFunction ids. Names are read from flash once per search rather
+// than once per code.
+uint32_t matchLibraryFunctions(const char* query) {
+  size_t queryLength = strlen(query);
+  if (queryLength == 0) return (1UL << LIBRARY_FUNCTION_COUNT) - 1;
+
+  uint32_t functions = 0;
+  char name[LIBRARY_NAME_LENGTH];
+  for (uint8_t function = 0; function < LIBRARY_FUNCTION_COUNT; function++) {
+    strncpy_P(name, LIBRARY_FUNCTION_NAMES[function], LIBRARY_NAME_LENGTH);
+    for (size_t start = 0; name[start] != '\0'; start++) {
+      if (strncasecmp(name + start, query, queryLength) == 0) {
+        functions |= 1UL << function;
+        break;
+      }
+    }
+  }
+  return functions;
+}
+
+// Used to resolve saved library buttons after the firmware is updated. Some
+// brands share codes (Springer is built by Midea), so the saved brand picks
+// between equal entries; without one the first match is used.
+int findLibraryCode(decode_type_t protocol, uint64_t value, uint16_t bits, int brand = -1) {
+  int firstMatch = -1;
+  for (int i = 0; i < LIBRARY_CODE_COUNT; i++) {
+    LibraryCode code = readLibraryCode(i);
+    if (code.protocol != protocol || code.value != value || code.bits != bits) continue;
+    if (brand < 0 || code.brand == brand) return i;
+    if (firstMatch < 0) firstMatch = i;
+  }
+  return firstMatch;
+}
+
+uint32_t fingerprintLibraryCode(int codeId) {
+  LibraryCode code = readLibraryCode(codeId);
+  return fingerprintCode((decode_type_t)code.protocol, code.value, code.bits);
+}
+
+// Rebuilt after every change to the stored signals, so lookups never need to
+// touch the signal data itself. Fingerprints are not kept per button; they
+// are cheap to recompute here and would cost RAM in every button slot.
+void rebuildFingerprintIndex() {
+  memset(fingerprintIndex, 0, sizeof(fingerprintIndex));
+
+  for (int i = 0; i < remoteCount; i++) {
+    if (!remotes[i].isActive) continue;
+
+    for (int j = 0; j < remotes[i].buttonCount; j++) {
+      const IRSignal& signal = remotes[i].buttons[j].signal;
+      if (!remotes[i].buttons[j].isActive || !signal.isValid) continue;
+      uint32_t fingerprint = signal.libraryCode >= 0 ? fingerprintLibraryCode(signal.libraryCode)
+                                                     : fingerprintTimings(signal.data, signal.length);
+      insertFingerprint(fingerprint, i, j);
+    }
+  }
+}
+
+// Schedule record functions
+// The schedules file, the backup and the API all use the same JSON object
+void writeScheduleRecord(Print& out, int index, DynamicJsonDocument& doc) {
+  static const char* typeNames[] = {"once", "daily", "weekly"};
+  const Schedule& schedule = schedules[index];
+
+  doc.clear();
+  doc["id"] = index;
+  doc["type"] = typeNames[schedule.type];
+  if (schedule.type == SCHEDULE_ONCE) {
+    doc["at"] = (uint64_t)schedule.fireMinute * 60;
+  } else {
+    char timeOfDay[6];
+    snprintf(timeOfDay, sizeof(timeOfDay), "%02d:%02d", schedule.minuteOfDay / 60, schedule.minuteOfDay % 60);
+    doc["time"] = timeOfDay;
+    doc["days"] = schedule.weekdays;
+  }
+
+  JsonArray stepsArray = doc.createNestedArray("steps");
+  for (int i = 0; i < schedule.stepCount; i++) {
+    JsonObject stepObj = stepsArray.createNestedObject();
+    stepObj["remoteId"] = schedule.steps[i].remoteId;
+    stepObj["buttonId"] = schedule.steps[i].buttonId;
+    stepObj["delayMs"] = schedule.steps[i].delayMs;
+  }
+
+  serializeJson(doc, out);
+}
+
+// Fills a schedule from a JSON object; shared by the loaders and the API.
+// Steps are only checked for shape here, buttons are checked when they run.
+bool parseSchedule(JsonObject obj, Schedule& schedule) {
+  const char* type = obj["type"] | "";
+  memset(&schedule, 0, sizeof(Schedule));
+
+  if (strcmp(type, "once") == 0) {
+    uint64_t at = obj["at"] | (uint64_t)0;
+    schedule.type = SCHEDULE_ONCE;
+    schedule.fireMinute = at / 60;
+    if (at < CLOCK_VALID_AFTER) return false;
+  } else if (strcmp(type, "daily") == 0 || strcmp(type, "weekly") == 0) {
+    int hour;
+    int minute;
+    if (sscanf(obj["time"] | "", "%d:%d", &hour, &minute) != 2 ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+      return false;
+    }
+    schedule.type = type[0] == 'd' ? SCHEDULE_DAILY : SCHEDULE_WEEKLY;
+    schedule.minuteOfDay = hour * 60 + minute;
+    schedule.weekdays = schedule.type == SCHEDULE_DAILY ? 0x7F : (obj["days"] | 0) & 0x7F;
+    if (schedule.weekdays == 0) return false;
+  } else {
+    return false;
+  }
+
+  JsonArray stepsArray = obj["steps"];
+  if (stepsArray.size() == 0 || stepsArray.size() > MAX_SCHEDULE_STEPS) return false;
+
+  for (JsonObject stepObj : stepsArray) {
+    int remoteId = stepObj["remoteId"] | -1;
+    int buttonId = stepObj["buttonId"] | -1;
+    int delayMs = stepObj["delayMs"] | 0;
+    if (remoteId < 0 || remoteId >= MAX_REMOTES || buttonId < 0 || buttonId >= MAX_BUTTONS_PER_REMOTE ||
+        delayMs < 0 || delayMs > MAX_MACRO_DELAY_MS) {
+      return false;
+    }
+
+    ScheduleStep& step = schedule.steps[schedule.stepCount++];
+    step.remoteId = remoteId;
+    step.buttonId = buttonId;
+    step.delayMs = delayMs;
+  }
+
+  schedule.isActive = true;
+  return true;
+}
+
+// Empties the schedule table; the wheel is rebuilt once the clock is set
+void clearSchedules() {
+  memset(schedules, 0, sizeof(schedules));
+  memset(wheel, 0xFF, sizeof(wheel));
+  wheelStarted = false;
+}
+
+// Backup functions
+// A backup is a sequence of one-line JSON records: a header, one record per
+// remote, per button and (in a download) per schedule, and an end record
+// with the totals. The timings of a
+// raw signal follow their button record as a bare JSON array on the next
+// line, so neither side ever needs the whole signal inside a JsonDocument.
+
+// Buffers output and sends it as HTTP chunks
+class ChunkedResponse : public Print {
+public:
+  size_t write(uint8_t c) override {
+    buffer[used++] = c;
+    if (used == BACKUP_CHUNK_SIZE) flush();
+    return 1;
+  }
+
+  void flush() override {
+    if (used > 0) {
+      server.sendContent((const char*)buffer, used);
+      used = 0;
+    }
+  }
+
+private:
+  uint8_t buffer[BACKUP_CHUNK_SIZE];
+  size_t used = 0;
+};
+
+void writeRecord(Print& out, DynamicJsonDocument& doc) {
+  serializeJson(doc, out);
+  out.print('\n');
+}
+
+void writeBackup(Print& out, bool withSchedules) {
+  int totalRemotes = 0;
+  int totalButtons = 0;
+  int totalSchedules = 0;
+
+  DynamicJsonDocument doc(256);
+  doc["type"] = "backup";
+  doc["version"] = BACKUP_VERSION;
+  writeRecord(out, doc);
 
   for (int i = 0; i < remoteCount; i++) {
     if (!remotes[i].isActive) continue;
 
-    JsonObject remoteObj = remotesArray.createNestedObject();
-    remoteObj["id"] = i;
-    remoteObj["name"] = remotes[i].name;
+    doc.clear();
+    doc["type"] = "remote";
+    doc["id"] = i;
+    doc["name"] = remotes[i].name;
+    doc["channel"] = remotes[i].channel;
+    writeRecord(out, doc);
+    totalRemotes++;
 
-    JsonArray buttonsArray = remoteObj.createNestedArray("buttons");
     for (int j = 0; j < remotes[i].buttonCount; j++) {
-      if (!remotes[i].buttons[j].isActive) continue;
+      const Button& button = remotes[i].buttons[j];
+      if (!button.isActive) continue;
+
+      doc.clear();
+      doc["type"] = "button";
+      doc["remoteId"] = i;
+      doc["id"] = j;
+      doc["name"] = button.name;
+      doc["hasSignal"] = button.signal.isValid;
+
+      bool hasRawData = false;
+      if (button.signal.isValid && button.signal.libraryCode >= 0) {
+        LibraryCode code = readLibraryCode(button.signal.libraryCode);
+        char brandName[LIBRARY_NAME_LENGTH];
+        strncpy_P(brandName, LIBRARY_BRAND_NAMES[code.brand], LIBRARY_NAME_LENGTH);
+        doc["protocol"] = typeToString((decode_type_t)code.protocol);
+        doc["value"] = uint64ToString(code.value, 16);
+        doc["bits"] = code.bits;
+        doc["brand"] = brandName;
+      } else if (button.signal.isValid) {
+        doc["length"] = button.signal.length;
+        hasRawData = true;
+      }
+      writeRecord(out, doc);
+      totalButtons++;
+
+      if (hasRawData) {
+        out.print('[');
+        for (int k = 0; k < button.signal.length; k++) {
+          if (k > 0) out.print(',');
+          out.print(button.signal.data[k]);
+        }
+        out.print("]\n");
+      }
+    }
+  }
+
+  // After the buttons, so a reader can check the steps against them
+  for (int i = 0; withSchedules && i < MAX_SCHEDULES; i++) {
+    if (!schedules[i].isActive) continue;
+
+    out.print("{\"type\":\"schedule\",\"schedule\":");
+    writeScheduleRecord(out, i, doc);
+    out.print("}\n");
+    totalSchedules++;
+  }
+
+  doc.clear();
+  doc["type"] = "end";
+  doc["remotes"] = totalRemotes;
+  doc["buttons"] = totalButtons;
+  doc["schedules"] = totalSchedules;
+  writeRecord(out, doc);
+}
+
+// Reads one record line into buffer, skipping blank lines, so a record can
+// never need more than RECORD_MAX_LENGTH bytes however the file was damaged
+bool readRecordLine(Stream& in, char* buffer, size_t size) {
+  size_t used = 0;
+
+  while (true) {
+    int c = in.read();
+    if (c < 0 || c == '\n') {
+      if (used > 0) break;
+      if (c < 0) return false;
+      continue;
+    }
+    if (c == '\r') continue;
+    if (used >= size - 1) return false;
+    buffer[used++] = c;
+  }
+
+  buffer[used] = '\0';
+  return true;
+}
+
+int readNonSpace(Stream& in) {
+  int c = in.read();
+  while (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+    c = in.read();
+  }
+  return c;
+}
+
+// Reads a timing array one digit at a time. With data == nullptr the array
+// is only validated.
+bool readTimingArray(Stream& in, uint16_t* data, uint16_t length) {
+  if (readNonSpace(in) != '[') return false;
+
+  uint16_t count = 0;
+  while (true) {
+    int c = readNonSpace(in);
+    uint32_t value = 0;
+    int digits = 0;
+    while (c >= '0' && c <= '9') {
+      value = value * 10 + (c - '0');
+      if (++digits > 5 || value > 0xFFFF) return false;
+      c = in.read();
+    }
+    if (digits == 0 || count >= length) return false;
+
+    if (data != nullptr) data[count] = value;
+    count++;
+
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') c = readNonSpace(in);
+    if (c == ']') break;
+    if (c != ',') return false;
+  }
+
+  return count == length;
+}
+
+// Frees every signal and empties the registry
+void clearRegistry() {
+  for (int i = 0; i < MAX_REMOTES; i++) {
+    for (int j = 0; j < MAX_BUTTONS_PER_REMOTE; j++) {
+      if (i < remoteCount && j < remotes[i].buttonCount &&
+          remotes[i].buttons[j].signal.data != nullptr) {
+        delete[] remotes[i].buttons[j].signal.data;
+      }
+      remotes[i].buttons[j].signal.data = nullptr;
+      remotes[i].buttons[j].signal.isValid = false;
+      remotes[i].buttons[j].isActive = false;
+    }
+    remotes[i].buttonCount = 0;
+    remotes[i].isActive = false;
+  }
+  remoteCount = 0;
+}
+
+// Parses a backup record by record. With apply == false nothing is changed,
+// the stream is only validated; with apply == true the records are loaded
+// into the (previously cleared) registry and schedule table.
+bool readBackup(Stream& in, bool apply, const char*& error) {
+  DynamicJsonDocument doc(512);
+  char line[RECORD_MAX_LENGTH];
+  bool remoteSeen[MAX_REMOTES] = {false};
+  uint32_t buttonSeen[MAX_REMOTES] = {0};
+  bool scheduleSeen[MAX_SCHEDULES] = {false};
+  bool headerSeen = false;
+  int totalRemotes = 0;
+  int totalButtons = 0;
+  int totalSchedules = 0;
+
+  while (true) {
+    if (!readRecordLine(in, line, sizeof(line)) ||
+        deserializeJson(doc, line, DeserializationOption::NestingLimit(4))) {
+      error = "Malformed record";
+      return false;
+    }
 
-      JsonObject buttonObj = buttonsArray.createNestedObject();
-      buttonObj["id"] = j;
-      buttonObj["name"] = remotes[i].buttons[j].name;
-      buttonObj["hasSignal"] = remotes[i].buttons[j].signal.isValid;
+    const char* type = doc["type"] | "";
 
-      if (remotes[i].buttons[j].signal.isValid) {
-        buttonObj["length"] = remotes[i].buttons[j].signal.length;
+    if (!headerSeen) {
+      if (strcmp(type, "backup") != 0 || (doc["version"] | 0) != BACKUP_VERSION) {
+        error = "Unsupported backup version";
+        return false;
+      }
+      headerSeen = true;
+    } else if (strcmp(type, "remote") == 0) {
+      int id = doc["id"] | -1;
+      const char* name = doc["name"];
+      int channel = doc["channel"] | 0;
+      if (id < 0 || id >= MAX_REMOTES || remoteSeen[id] || name == nullptr || channel < 0) {
+        error = "Invalid remote record";
+        return false;
+      }
 
-        JsonArray signalArray = buttonObj.createNestedArray("data");
-        for (int k = 0; k < remotes[i].buttons[j].signal.length; k++) {
-          signalArray.add(remotes[i].buttons[j].signal.data[k]);
+      // Data from a board with more emitters falls back to the first one
+      if (channel >= IR_CHANNEL_COUNT) channel = 0;
+      remoteSeen[id] = true;
+      totalRemotes++;
+
+      if (apply) {
+        strncpy(remotes[id].name, name, MAX_NAME_LENGTH - 1);
+        remotes[id].name[MAX_NAME_LENGTH - 1] = '\0';
+        remotes[id].channel = channel;
+        remotes[id].isActive = true;
+        remotes[id].buttonCount = 0;
+        remoteCount = max(remoteCount, id + 1);
+      }
+    } else if (strcmp(type, "button") == 0) {
+      int remoteId = doc["remoteId"] | -1;
+      int id = doc["id"] | -1;
+      const char* name = doc["name"];
+      bool hasSignal = doc["hasSignal"];
+      if (remoteId < 0 || remoteId >= MAX_REMOTES || !remoteSeen[remoteId] ||
+          id < 0 || id >= MAX_BUTTONS_PER_REMOTE || (buttonSeen[remoteId] & (1UL << id)) ||
+          name == nullptr) {
+        error = "Invalid button record";
+        return false;
+      }
+      buttonSeen[remoteId] |= 1UL << id;
+      totalButtons++;
+
+      int codeId = -1;
+      uint16_t length = 0;
+      if (hasSignal && doc.containsKey("protocol")) {
+        codeId = findLibraryCode(strToDecodeType(doc["protocol"] | ""),
+                                 strtoull(doc["value"] | "0", nullptr, 16), doc["bits"] | 0,
+                                 findLibraryBrand(doc["brand"] | ""));
+        if (codeId < 0) {
+          error = "Unknown library code";
+          return false;
+        }
+      } else if (hasSignal) {
+        length = doc["length"] | 0;
+        if (length == 0 || length > CAPTURE_BUFFER_SIZE) {
+          error = "Invalid signal length";
+          return false;
         }
       }
+
+      Button* button = apply ? &remotes[remoteId].buttons[id] : nullptr;
+      // At most CAPTURE_BUFFER_SIZE entries; a failed allocation is reported
+      // rather than aborting, so a large file cannot trap the board in resets
+      uint16_t* data = (apply && length > 0) ? new (std::nothrow) uint16_t[length] : nullptr;
+      if (apply && length > 0 && data == nullptr) {
+        error = "Out of memory";
+        return false;
+      }
+
+      if (length > 0 && !readTimingArray(in, data, length)) {
+        delete[] data;
+        error = "Invalid signal data";
+        return false;
+      }
+
+      if (apply) {
+        strncpy(button->name, name, MAX_NAME_LENGTH - 1);
+        button->name[MAX_NAME_LENGTH - 1] = '\0';
+        button->isActive = true;
+        button->signal.data = data;
+        button->signal.length = length;
+        button->signal.libraryCode = codeId;
+        button->signal.isValid = hasSignal;
+        remotes[remoteId].buttonCount = max(remotes[remoteId].buttonCount, id + 1);
+      }
+    } else if (strcmp(type, "schedule") == 0) {
+      JsonObject scheduleObj = doc["schedule"];
+      int id = scheduleObj["id"] | -1;
+      Schedule schedule;
+      bool valid = id >= 0 && id < MAX_SCHEDULES && !scheduleSeen[id] && parseSchedule(scheduleObj, schedule);
+      // Steps name buttons by id, so they must be buttons of this backup
+      for (int i = 0; valid && i < schedule.stepCount; i++) {
+        valid = buttonSeen[schedule.steps[i].remoteId] & (1UL << schedule.steps[i].buttonId);
+      }
+      if (!valid) {
+        error = "Invalid schedule record";
+        return false;
+      }
+      scheduleSeen[id] = true;
+      totalSchedules++;
+
+      if (apply) schedules[id] = schedule;
+    } else if (strcmp(type, "end") == 0) {
+      if ((doc["remotes"] | -1) != totalRemotes || (doc["buttons"] | -1) != totalButtons ||
+          (doc["schedules"] | 0) != totalSchedules) {
+        error = "Backup is incomplete";
+        return false;
+      }
+      return true;
+    } else {
+      error = "Unknown record type";
+      return false;
     }
   }
+}
+
+// Persistence functions
+// The data file uses the backup format, so saving and loading stream one
+// record at a time and never need more than a small document, however many
+// signals are stored
+void saveData() {
+  // Saving now would replace data that is still on flash with whatever part
+  // of it made it into memory
+  if (savesBlocked) {
+    Serial.println("Saving disabled: stored data could not be loaded");
+    return;
+  }
 
-  File file = LittleFS.open("/remotes.json", "w");
+  Serial.println("Saving data to LittleFS...");
+
+  // Written to a temporary file first so a reset mid-write never leaves a
+  // truncated data file behind
+  File file = LittleFS.open(DATA_TEMP_PATH, "w");
   if (!file) {
     Serial.println("Failed to open file for writing");
     return;
   }
 
-  if (serializeJson(doc, file) == 0) {
+  writeBackup(file, false); // Schedules have their own file
+  flashBytesWritten += file.size();
+  file.close();
+
+  // A full flash truncates the file silently, so read it back before it
+  // replaces the previous one
+  const char* error = nullptr;
+  file = LittleFS.open(DATA_TEMP_PATH, "r");
+  bool valid = file && readBackup(file, false, error);
+  if (file) file.close();
+
+  if (!valid) {
     Serial.println("Failed to write to file");
+    LittleFS.remove(DATA_TEMP_PATH);
+  } else if (!LittleFS.rename(DATA_TEMP_PATH, DATA_PATH)) {
+    Serial.println("Failed to replace data file");
   } else {
+    if (LittleFS.exists(LEGACY_DATA_PATH)) LittleFS.remove(LEGACY_DATA_PATH);
     Serial.println("Data saved successfully");
   }
-
-  file.close();
 }
 
-void loadData() {
-  Serial.println("Loading data from LittleFS...");
-
-  if (!LittleFS.exists("/remotes.json")) {
-    Serial.println("No saved data found");
-    return;
-  }
-
-  File file = LittleFS.open("/remotes.json", "r");
+// Reads the single-document format used before the record-per-line file. It
+// needs one large document, so it only runs once, at boot, to migrate.
+bool loadLegacyData() {
+  File file = LittleFS.open(LEGACY_DATA_PATH, "r");
   if (!file) {
     Serial.println("Failed to open file for reading");
-    return;
+    return false;
   }
 
   DynamicJsonDocument doc(16384);
@@ -131,49 +906,80 @@ void loadData() {
   if (error) {
     Serial.print("Failed to parse JSON: ");
     Serial.println(error.c_str());
-    return;
+    return false;
   }
 
   JsonArray remotesArray = doc["remotes"];
   remoteCount = 0;
 
   for (JsonObject remoteObj : remotesArray) {
-    int id = remoteObj["id"];
+    int id = remoteObj["id"] | -1;
     const char* name = remoteObj["name"];
 
-    if (id >= 0 && id < MAX_REMOTES) {
+    // Every field is checked, since the file may be damaged
+    if (id >= 0 && id < MAX_REMOTES && !remotes[id].isActive && name != nullptr) {
       strncpy(remotes[id].name, name, MAX_NAME_LENGTH - 1);
       remotes[id].name[MAX_NAME_LENGTH - 1] = '\0';
+      remotes[id].channel = 0;
       remotes[id].isActive = true;
       remotes[id].buttonCount = 0;
 
       JsonArray buttonsArray = remoteObj["buttons"];
       for (JsonObject buttonObj : buttonsArray) {
-        int btnId = buttonObj["id"];
+        int btnId = buttonObj["id"] | -1;
         const char* btnName = buttonObj["name"];
         bool hasSignal = buttonObj["hasSignal"];
 
-        if (btnId >= 0 && btnId < MAX_BUTTONS_PER_REMOTE) {
+        if (btnId >= 0 && btnId < MAX_BUTTONS_PER_REMOTE && !remotes[id].buttons[btnId].isActive &&
+            btnName != nullptr) {
           strncpy(remotes[id].buttons[btnId].name, btnName, MAX_NAME_LENGTH - 1);
           remotes[id].buttons[btnId].name[MAX_NAME_LENGTH - 1] = '\0';
           remotes[id].buttons[btnId].isActive = true;
           remotes[id].buttons[btnId].signal.isValid = hasSignal;
+          remotes[id].buttons[btnId].signal.libraryCode = -1;
 
-          if (hasSignal) {
-            uint16_t length = buttonObj["length"];
-            remotes[id].buttons[btnId].signal.length = length;
-
-            // Allocate memory for signal data
-            remotes[id].buttons[btnId].signal.data = new uint16_t[length];
+          if (hasSignal && buttonObj.containsKey("protocol")) {
+            decode_type_t protocol = strToDecodeType(buttonObj["protocol"] | "");
+            uint64_t value = strtoull(buttonObj["value"] | "0", nullptr, 16);
+            uint16_t bits = buttonObj["bits"];
+            int codeId = findLibraryCode(protocol, value, bits);
 
+            remotes[id].buttons[btnId].signal.data = nullptr;
+            remotes[id].buttons[btnId].signal.length = 0;
+            remotes[id].buttons[btnId].signal.libraryCode = codeId;
+            remotes[id].buttons[btnId].signal.isValid = codeId >= 0;
+            if (codeId < 0) {
+              Serial.print("Library code not found for button: ");
+              Serial.println(btnName);
+            }
+          } else if (hasSignal) {
             JsonArray signalArray = buttonObj["data"];
-            int k = 0;
-            for (JsonVariant value : signalArray) {
-              if (k < length) {
-                remotes[id].buttons[btnId].signal.data[k] = value.as<uint16_t>();
-                k++;
+            uint16_t length = buttonObj["length"] | 0;
+            uint16_t* data = nullptr;
+
+            // Bounded by the capture buffer, and only allocated when the
+            // stored array really has that many entries
+            if (length > 0 && length <= CAPTURE_BUFFER_SIZE && signalArray.size() == length) {
+              data = new (std::nothrow) uint16_t[length];
+              if (data == nullptr) {
+                Serial.println("Out of memory loading signals");
+                return false;
               }
             }
+            if (data != nullptr) {
+              int k = 0;
+              for (JsonVariant value : signalArray) {
+                data[k++] = value.as<uint16_t>();
+              }
+            } else {
+              Serial.print("Invalid signal for button: ");
+              Serial.println(btnName);
+              length = 0;
+            }
+
+            remotes[id].buttons[btnId].signal.data = data;
+            remotes[id].buttons[btnId].signal.length = length;
+            remotes[id].buttons[btnId].signal.isValid = data != nullptr;
           } else {
             remotes[id].buttons[btnId].signal.data = nullptr;
             remotes[id].buttons[btnId].signal.length = 0;
@@ -187,9 +993,102 @@ void loadData() {
     }
   }
 
+  return true;
+}
+
+// Loads the registry all or nothing. If stored data exists but cannot be
+// loaded (damaged, or out of memory while applying it) the registry is left
+// empty and saves are blocked, so the file on flash is never overwritten
+// with a partial copy.
+bool loadData() {
+  Serial.println("Loading data from LittleFS...");
+
+  if (LittleFS.exists(DATA_PATH)) {
+    // Validate everything before touching the registry
+    const char* error = nullptr;
+    File file = LittleFS.open(DATA_PATH, "r");
+    bool loaded = file && readBackup(file, false, error);
+    if (file) file.close();
+
+    if (loaded) {
+      file = LittleFS.open(DATA_PATH, "r");
+      loaded = file && readBackup(file, true, error);
+      if (file) file.close();
+    }
+
+    if (!loaded) {
+      Serial.print("Failed to load data file: ");
+      Serial.println(error != nullptr ? error : "open failed");
+      clearRegistry();
+      savesBlocked = true;
+      return false;
+    }
+  } else if (LittleFS.exists(LEGACY_DATA_PATH)) {
+    if (!loadLegacyData()) {
+      clearRegistry();
+      savesBlocked = true;
+      return false;
+    }
+    saveData(); // Migrate to the record-per-line file
+  } else {
+    Serial.println("No saved data found");
+    return true;
+  }
+
+  rebuildFingerprintIndex();
+
   Serial.print("Loaded ");
   Serial.print(remoteCount);
   Serial.println(" remotes from storage");
+  return true;
+}
+
+// One schedule per line, so loading never holds more than one in a document
+void saveSchedules() {
+  File file = LittleFS.open(SCHEDULES_TEMP_PATH, "w");
+  if (!file) {
+    Serial.println("Failed to open schedules file for writing");
+    return;
+  }
+
+  DynamicJsonDocument doc(512);
+  for (int i = 0; i < MAX_SCHEDULES; i++) {
+    if (!schedules[i].isActive) continue;
+    writeScheduleRecord(file, i, doc);
+    file.print('\n');
+  }
+  flashBytesWritten += file.size();
+  file.close();
+
+  if (!LittleFS.rename(SCHEDULES_TEMP_PATH, SCHEDULES_PATH)) {
+    Serial.println("Failed to replace schedules file");
+  }
+}
+
+void loadSchedules() {
+  clearSchedules();
+
+  File file = LittleFS.open(SCHEDULES_PATH, "r");
+  if (!file) return;
+
+  DynamicJsonDocument doc(512);
+  char line[RECORD_MAX_LENGTH];
+  int loaded = 0;
+  while (readRecordLine(file, line, sizeof(line)) &&
+         deserializeJson(doc, line, DeserializationOption::NestingLimit(3)) == DeserializationError::Ok) {
+    int id = doc["id"] | -1;
+    Schedule schedule;
+    if (id >= 0 && id < MAX_SCHEDULES && !schedules[id].isActive &&
+        parseSchedule(doc.as<JsonObject>(), schedule)) {
+      schedules[id] = schedule;
+      loaded++;
+    }
+  }
+  file.close();
+
+  Serial.print("Loaded ");
+  Serial.print(loaded);
+  Serial.println(" schedules from storage");
 }
 
 // IR helper functions
@@ -198,6 +1097,7 @@ IRSignal captureIRSignal() {
   signal.isValid = false;
   signal.data = nullptr;
   signal.length = 0;
+  signal.libraryCode = -1;
 
   if (irrecv.decode(&irReadingResults)) {
     signal.length = getCorrectedRawLength(&irReadingResults);
@@ -209,92 +1109,1159 @@ IRSignal captureIRSignal() {
   return signal;
 }
 
-void sendIRSignal(IRSignal signal) {
-  if (signal.isValid && signal.data != nullptr && signal.length > 0) {
-    irsend.sendRaw(signal.data, signal.length, IR_LED_FREQUENCY);
-    delay(50);
+// Matches a received frame against the stored buttons without copying it
+// out of the capture buffer
+void listenForKnownSignal() {
+  if (!irrecv.decode(&irReadingResults)) return;
+
+  listenFrameCount++;
+  int slot = -1;
+  uint32_t fingerprint = 0;
+
+  // Library buttons are indexed by code, recorded buttons by timing
+  if (irReadingResults.decode_type > UNUSED && !irReadingResults.repeat) {
+    fingerprint = fingerprintCode(irReadingResults.decode_type, irReadingResults.value, irReadingResults.bits);
+    slot = findFingerprint(fingerprint);
   }
-}
+  if (slot < 0) {
+    fingerprint = fingerprintTimings(
+      (const uint16_t*)irReadingResults.rawbuf + 1, irReadingResults.rawlen - 1);
+    slot = findFingerprint(fingerprint);
+  }
+  irrecv.resume();
 
-// Remote control management functions
-int addRemote(const char* name) {
-  if (remoteCount >= MAX_REMOTES) return -1;
+  if (slot < 0) return;
 
-  strncpy(remotes[remoteCount].name, name, MAX_NAME_LENGTH - 1);
-  remotes[remoteCount].name[MAX_NAME_LENGTH - 1] = '\0';
-  remotes[remoteCount].buttonCount = 0;
-  remotes[remoteCount].isActive = true;
+  int remoteId = fingerprintIndex[slot].remoteId;
+  int buttonId = fingerprintIndex[slot].buttonId;
+  listenMatchCount++;
+  lastMatchRemoteId = remoteId;
+  lastMatchButtonId = buttonId;
+  lastMatchFingerprint = fingerprint;
+  lastMatchAt = millis();
 
-  return remoteCount++;
+  Serial.print("Sinal reconhecido: ");
+  Serial.print(remotes[remoteId].name);
+  Serial.print(" - ");
+  Serial.println(remotes[remoteId].buttons[buttonId].name);
 }
 
-int addButton(int remoteId, const char* name) {
-  if (remoteId < 0 || remoteId >= remoteCount) return -1;
-  if (remotes[remoteId].buttonCount >= MAX_BUTTONS_PER_REMOTE) return -1;
+void sendIRSignal(IRSignal signal, int channel) {
+  if (signal.isValid && signal.libraryCode >= 0) {
+    LibraryCode code = readLibraryCode(signal.libraryCode);
+    irsend[channel]->send((decode_type_t)code.protocol, code.value, code.bits);
+  } else if (signal.isValid && signal.data != nullptr && signal.length > 0) {
+    irsend[channel]->sendRaw(signal.data, signal.length, IR_LED_FREQUENCY);
+  }
+}
 
-  int buttonId = remotes[remoteId].buttonCount;
-  strncpy(remotes[remoteId].buttons[buttonId].name, name, MAX_NAME_LENGTH - 1);
-  remotes[remoteId].buttons[buttonId].name[MAX_NAME_LENGTH - 1] = '\0';
-  remotes[remoteId].buttons[buttonId].signal.isValid = false;
-  remotes[remoteId].buttons[buttonId].signal.data = nullptr;
-  remotes[remoteId].buttons[buttonId].signal.length = 0;
-  remotes[remoteId].buttons[buttonId].isActive = true;
-  remotes[remoteId].buttonCount++;
+// Deferred work functions
+// Handlers only queue transmissions and flag the registry as dirty; both are
+// carried out from loop() once the response has been sent.
+// The gap is counted from the last frame on afterChannel (by default the
+// job's own channel); a macro passes the channel of its previous step so its
+// delays hold across emitters too
+bool queueTransmit(int remoteId, int buttonId, uint16_t gapMs = TX_FRAME_GAP_MS, int afterChannel = -1) {
+  int channelId = remotes[remoteId].channel;
+  TransmitChannel& channel = channels[channelId];
+  if (channel.count >= TX_QUEUE_SIZE) return false;
+  if (afterChannel < 0) afterChannel = channelId;
+
+  TransmitJob& job = channel.queue[(channel.head + channel.count) % TX_QUEUE_SIZE];
+  job.remoteId = remoteId;
+  job.buttonId = buttonId;
+  job.afterChannel = afterChannel;
+  job.afterSequence = channels[afterChannel].lastSequence;
+  job.sequence = ++transmitSequence;
+  job.gapMs = gapMs;
+  job.queuedAt = micros();
+  channel.lastSequence = job.sequence;
+  channel.count++;
+  return true;
+}
 
-  return buttonId;
+int pendingTransmits() {
+  int pending = 0;
+  for (int c = 0; c < IR_CHANNEL_COUNT; c++) {
+    pending += channels[c].count;
+  }
+  return pending;
 }
 
-// HTTP Handlers
-void handleRoot() {
-  server.send(200, "text/html", HTML_CONTENT);
+bool transmitIsDue(const TransmitJob& job) {
+  const TransmitChannel& after = channels[job.afterChannel];
+
+  // The frame it follows may still be queued on another channel
+  if (after.count > 0 && (int32_t)(after.queue[after.head].sequence - job.afterSequence) <= 0) return false;
+  return millis() - after.lastTransmitAt >= job.gapMs;
 }
 
-void handleGetRemotes() {
-  DynamicJsonDocument doc(4096);
-  JsonArray remotesArray = doc.createNestedArray("remotes");
+// How long the next frame of a channel has been ready to go out, in ms, or
+// -1 while it still waits for its gap, its macro delay or the frame before it
+long transmitLatenessMs(const TransmitChannel& channel) {
+  if (channel.count == 0 || !transmitIsDue(channel.queue[channel.head])) return -1;
 
-  for (int i = 0; i < remoteCount; i++) {
-    if (remotes[i].isActive) {
-      JsonObject remoteObj = remotesArray.createNestedObject();
-      remoteObj["id"] = i;
-      remoteObj["name"] = remotes[i].name;
+  const TransmitJob& job = channel.queue[channel.head];
+  unsigned long queuedAgo = (micros() - job.queuedAt) / 1000;
+  unsigned long gapEndedAgo = millis() - channels[job.afterChannel].lastTransmitAt - job.gapMs;
+  return min(queuedAgo, gapEndedAgo);
+}
 
-      JsonArray buttonsArray = remoteObj.createNestedArray("buttons");
-      for (int j = 0; j < remotes[i].buttonCount; j++) {
-        if (remotes[i].buttons[j].isActive) {
-          JsonObject buttonObj = buttonsArray.createNestedObject();
-          buttonObj["id"] = j;
-          buttonObj["name"] = remotes[i].buttons[j].name;
+// Frames still waiting out a delay are not load: a macro with long delays
+// must not lock the management routes out while it runs
+bool transmitsAreLate() {
+  for (int c = 0; c < IR_CHANNEL_COUNT; c++) {
+    if (transmitLatenessMs(channels[c]) >= LANE_SHED_LATE_MS) return true;
+  }
+  return false;
+}
+
+void recordLaneLatency(int lane, uint32_t latencyUs) {
+  laneStats[lane].latencySamples++;
+  laneStats[lane].latencySumUs += latencyUs;
+  laneStats[lane].latencyMaxUs = max(laneStats[lane].latencyMaxUs, latencyUs);
+}
+
+// Sends at most one frame per call, keeping the gap the receivers need
+// between frames without blocking loop(). Channels take turns and each keeps
+// its own gap, so one channel sends while another waits. The emitters are
+// driven by the CPU, so frames are interleaved rather than simultaneous.
+void serviceTransmitQueue() {
+  int channelId = -1;
+  for (int n = 0; n < IR_CHANNEL_COUNT && channelId < 0; n++) {
+    int c = (nextChannel + n) % IR_CHANNEL_COUNT;
+    if (channels[c].count > 0 && transmitIsDue(channels[c].queue[channels[c].head])) channelId = c;
+  }
+  if (channelId < 0) return;
+
+  TransmitChannel& channel = channels[channelId];
+  TransmitJob job = channel.queue[channel.head];
+  channel.head = (channel.head + 1) % TX_QUEUE_SIZE;
+  channel.count--;
+  nextChannel = (channelId + 1) % IR_CHANNEL_COUNT;
+
+  // The button may have been deleted while the job was queued
+  if (job.remoteId >= remoteCount || !remotes[job.remoteId].isActive ||
+      job.buttonId >= remotes[job.remoteId].buttonCount ||
+      !remotes[job.remoteId].buttons[job.buttonId].isActive) {
+    return;
+  }
+
+  sendIRSignal(remotes[job.remoteId].buttons[job.buttonId].signal, channelId);
+  lastTransmitAt = millis();
+  channel.lastTransmitAt = lastTransmitAt;
+
+  // Real-time latency runs from queueing to the end of the frame
+  uint32_t latencyUs = micros() - job.queuedAt;
+  channel.frames++;
+  channel.latencySumUs += latencyUs;
+  channel.latencyMaxUs = max(channel.latencyMaxUs, latencyUs);
+  recordLaneLatency(LANE_REALTIME, latencyUs);
+  Serial.println("Sinal IR enviado");
+}
+
+void requestSave() {
+  if (!saveRequested && !schedulesSaveRequested) saveRequestedAt = millis();
+  saveRequested = true;
+}
+
+void requestSchedulesSave() {
+  if (!saveRequested && !schedulesSaveRequested) saveRequestedAt = millis();
+  schedulesSaveRequested = true;
+}
+
+// Flash writes wait until transmissions have been quiet for a while, since a
+// save blocks the loop and would delay the next button press
+void serviceDeferredSave() {
+  if (!saveRequested && !schedulesSaveRequested) return;
+
+  unsigned long waited = millis() - saveRequestedAt;
+  if (waited < SAVE_DELAY_MS) return;
+  if (waited < SAVE_MAX_DELAY_MS &&
+      (pendingTransmits() > 0 || millis() - lastTransmitAt < SAVE_QUIET_MS)) {
+    return;
+  }
+
+  unsigned long startedAt = millis();
+  if (schedulesSaveRequested) {
+    schedulesSaveRequested = false;
+    saveSchedules();
+  }
+  bool registrySaved = saveRequested;
+  if (saveRequested) {
+    saveRequested = false;
+    saveData();
+  }
+  lastSaveDurationMs = millis() - startedAt;
+  saveCount++;
+
+  // Peers learn the new registry size without having to ask
+  if (registrySaved && mdnsStarted) MDNS.announce();
+}
+
+// Runs a handler in its lane. Management requests are shed while a queued
+// frame is overdue, i.e. loop() is falling behind; their latency is the handler time, while real-time
+// latency is recorded when the queued frame has been sent.
+void handleInLane(int lane, void (*handler)()) {
+  unsigned long startedAt = micros();
+  laneStats[lane].requests++;
+
+  if (lane == LANE_MANAGEMENT && transmitsAreLate()) {
+    laneStats[lane].shed++;
+    server.sendHeader("Retry-After", "1");
+    server.send(503, "application/json", "{\"error\":\"Busy sending signals, try again\"}");
+    return;
+  }
+
+  handler();
+
+  if (lane == LANE_MANAGEMENT) {
+    recordLaneLatency(lane, micros() - startedAt);
+  }
+}
+
+// Request bodies are copied here as they arrive instead of being kept by
+// the server as a String, so a body over the limit is refused from its
+// declared length and never takes RAM
+char requestBody[REQUEST_BODY_MAX_LENGTH + 1];
+size_t requestBodyLength = 0;
+bool requestBodyReceived = false;
+bool requestBodyTooLarge = false;
+
+void handleRequestBodyRaw() {
+  HTTPRaw& raw = server.raw();
+
+  if (raw.status == RAW_START) {
+    requestBodyLength = 0;
+    requestBodyReceived = true;
+    requestBodyTooLarge = server.clientContentLength() > REQUEST_BODY_MAX_LENGTH;
+  } else if (raw.status == RAW_WRITE && !requestBodyTooLarge) {
+    if (requestBodyLength + raw.currentSize > REQUEST_BODY_MAX_LENGTH) {
+      requestBodyTooLarge = true;
+      return;
+    }
+    memcpy(requestBody + requestBodyLength, raw.buf, raw.currentSize);
+    requestBodyLength += raw.currentSize;
+  } else if (raw.status == RAW_ABORTED) {
+    requestBodyReceived = false;
+  }
+}
+
+void onRoute(const char* uri, HTTPMethod method, int lane, void (*handler)()) {
+  server.on(uri, method, [lane, handler]() {
+    handleInLane(lane, handler);
+    requestBodyReceived = false;
+  }, handleRequestBodyRaw);
+}
+
+// Remote control management functions
+int addRemote(const char* name) {
+  if (remoteCount >= MAX_REMOTES || name == nullptr) return -1;
+
+  strncpy(remotes[remoteCount].name, name, MAX_NAME_LENGTH - 1);
+  remotes[remoteCount].name[MAX_NAME_LENGTH - 1] = '\0';
+  remotes[remoteCount].buttonCount = 0;
+  remotes[remoteCount].channel = 0;
+  remotes[remoteCount].isActive = true;
+
+  return remoteCount++;
+}
+
+int addButton(int remoteId, const char* name) {
+  if (remoteId < 0 || remoteId >= remoteCount || name == nullptr) return -1;
+  if (remotes[remoteId].buttonCount >= MAX_BUTTONS_PER_REMOTE) return -1;
+
+  int buttonId = remotes[remoteId].buttonCount;
+  strncpy(remotes[remoteId].buttons[buttonId].name, name, MAX_NAME_LENGTH - 1);
+  remotes[remoteId].buttons[buttonId].name[MAX_NAME_LENGTH - 1] = '\0';
+  remotes[remoteId].buttons[buttonId].signal.isValid = false;
+  remotes[remoteId].buttons[buttonId].signal.data = nullptr;
+  remotes[remoteId].buttons[buttonId].signal.length = 0;
+  remotes[remoteId].buttons[buttonId].signal.libraryCode = -1;
+  remotes[remoteId].buttons[buttonId].isActive = true;
+  remotes[remoteId].buttonCount++;
+
+  return buttonId;
+}
+
+// Command functions
+// The HTTP handlers and the serial interface are thin parsers around these
+bool isValidButton(int remoteId, int buttonId) {
+  return remoteId >= 0 && remoteId < remoteCount && remotes[remoteId].isActive &&
+         buttonId >= 0 && buttonId < remotes[remoteId].buttonCount &&
+         remotes[remoteId].buttons[buttonId].isActive;
+}
+
+const char* commandError(CommandResult result) {
+  switch (result) {
+    case COMMAND_INVALID_ID: return "Invalid remote or button ID";
+    case COMMAND_NO_SIGNAL: return "No signal recorded for this button";
+    case COMMAND_INVALID_STEP: return "Invalid macro step";
+    case COMMAND_TOO_MANY_STEPS: return "Too many steps";
+    case COMMAND_NO_MATCH: return "No matching button";
+    case COMMAND_QUEUE_FULL: return "Transmit queue full";
+    default: return "";
+  }
+}
+
+CommandResult commandSend(int remoteId, int buttonId) {
+  if (!isValidButton(remoteId, buttonId)) return COMMAND_INVALID_ID;
+  if (!remotes[remoteId].buttons[buttonId].signal.isValid) return COMMAND_NO_SIGNAL;
+  if (!queueTransmit(remoteId, buttonId)) return COMMAND_QUEUE_FULL;
+  return COMMAND_OK;
+}
+
+// Sends every button called buttonName, optionally only on remotes called
+// remoteName; names are compared case-insensitively
+CommandResult commandSendByName(const char* remoteName, const char* buttonName, int& matched) {
+  matched = 0;
+  if (buttonName == nullptr) return COMMAND_NO_MATCH;
+
+  for (int i = 0; i < remoteCount; i++) {
+    if (!remotes[i].isActive) continue;
+    if (remoteName != nullptr && remoteName[0] != '\0' && strcasecmp(remotes[i].name, remoteName) != 0) continue;
+
+    for (int j = 0; j < remotes[i].buttonCount; j++) {
+      const Button& button = remotes[i].buttons[j];
+      if (!button.isActive || !button.signal.isValid || strcasecmp(button.name, buttonName) != 0) continue;
+      if (!queueTransmit(i, j)) return COMMAND_QUEUE_FULL;
+      matched++;
+    }
+  }
+
+  return matched > 0 ? COMMAND_OK : COMMAND_NO_MATCH;
+}
+
+// Every step is validated before any is queued, so a macro runs entirely or not at all
+CommandResult commandMacro(const MacroStep* steps, int count) {
+  if (count <= 0) return COMMAND_INVALID_STEP;
+  if (count > TX_QUEUE_SIZE) return COMMAND_TOO_MANY_STEPS;
+
+  int needed[IR_CHANNEL_COUNT] = {0};
+  for (int i = 0; i < count; i++) {
+    if (!isValidButton(steps[i].remoteId, steps[i].buttonId) ||
+        !remotes[steps[i].remoteId].buttons[steps[i].buttonId].signal.isValid ||
+        steps[i].delayMs > MAX_MACRO_DELAY_MS) {
+      return COMMAND_INVALID_STEP;
+    }
+    needed[remotes[steps[i].remoteId].channel]++;
+  }
+
+  // Only a macro that could fit once the queue drains is worth retrying
+  for (int c = 0; c < IR_CHANNEL_COUNT; c++) {
+    if (needed[c] > TX_QUEUE_SIZE - channels[c].count) return COMMAND_QUEUE_FULL;
+  }
+
+  // Each step waits for the previous one, whichever channel it went to
+  int previousChannel = -1;
+  for (int i = 0; i < count; i++) {
+    queueTransmit(steps[i].remoteId, steps[i].buttonId, max((int)steps[i].delayMs, TX_FRAME_GAP_MS), previousChannel);
+    previousChannel = remotes[steps[i].remoteId].channel;
+  }
+  return COMMAND_OK;
+}
+
+CommandResult commandStartRecording(int remoteId, int buttonId) {
+  if (!isValidButton(remoteId, buttonId)) return COMMAND_INVALID_ID;
+
+  recordingRemoteId = remoteId;
+  recordingButtonId = buttonId;
+  recordingMode = true;
+
+  // Clear IR buffer
+  irrecv.resume();
+
+  Serial.println("Modo de gravacao iniciado");
+  return COMMAND_OK;
+}
+
+void commandStopRecording() {
+  recordingMode = false;
+  recordingRemoteId = -1;
+  recordingButtonId = -1;
+
+  Serial.println("Modo de gravacao parado");
+}
+
+void buildRemotesList(DynamicJsonDocument& doc) {
+  doc["channels"] = IR_CHANNEL_COUNT;
+  JsonArray remotesArray = doc.createNestedArray("remotes");
+
+  for (int i = 0; i < remoteCount; i++) {
+    if (remotes[i].isActive) {
+      JsonObject remoteObj = remotesArray.createNestedObject();
+      remoteObj["id"] = i;
+      remoteObj["name"] = remotes[i].name;
+      remoteObj["channel"] = remotes[i].channel;
+
+      JsonArray buttonsArray = remoteObj.createNestedArray("buttons");
+      for (int j = 0; j < remotes[i].buttonCount; j++) {
+        if (remotes[i].buttons[j].isActive) {
+          JsonObject buttonObj = buttonsArray.createNestedObject();
+          buttonObj["id"] = j;
+          buttonObj["name"] = remotes[i].buttons[j].name;
           buttonObj["hasSignal"] = remotes[i].buttons[j].signal.isValid;
         }
       }
     }
   }
+}
 
-  String response;
-  serializeJson(doc, response);
-  server.send(200, "application/json", response);
+// Hold functions
+// While a button is held the first frame is sent whole and the following ones
+// at the protocol's own period, from loop(). NEC-style signals repeat with
+// the short repeat frame, which receivers treat as "still held" (volume
+// ramps); any other signal repeats the whole frame.
+const uint16_t NEC_REPEAT_FRAME[] = {9000, 2250, 560};
+
+bool isNecLike(const IRSignal& signal) {
+  if (signal.libraryCode >= 0) {
+    decode_type_t protocol = (decode_type_t)readLibraryCode(signal.libraryCode).protocol;
+    return protocol == NEC || protocol == NEC_LIKE;
+  }
+
+  // 9ms mark and 4.5ms space leader
+  return signal.length > 2 && signal.data[0] > 8000 && signal.data[0] < 10000 &&
+         signal.data[1] > 4000 && signal.data[1] < 5000;
 }
 
-void handleAddRemote() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
+// Start-to-start period between two frames while held
+uint16_t holdPeriodMs(const IRSignal& signal) {
+  if (isNecLike(signal)) return NEC_REPEAT_PERIOD_MS;
+  if (signal.libraryCode >= 0) return HOLD_LIBRARY_PERIOD_MS;
+
+  uint32_t frameUs = 0;
+  for (int k = 0; k < signal.length; k++) {
+    frameUs += signal.data[k];
+  }
+  return frameUs / 1000 + TX_FRAME_GAP_MS;
+}
+
+// Starts holding a button, or renews the hold if it is already held. With
+// renewOnly set a button that is no longer held is not started again, so a
+// renewal arriving after the release cannot restart it.
+CommandResult commandHold(int remoteId, int buttonId, bool renewOnly) {
+  if (!isValidButton(remoteId, buttonId)) return COMMAND_INVALID_ID;
+  if (!remotes[remoteId].buttons[buttonId].signal.isValid) return COMMAND_NO_SIGNAL;
+
+  if (remoteId == holdRemoteId && buttonId == holdButtonId) {
+    holdRenewedAt = millis();
+    return COMMAND_OK;
+  }
+  if (renewOnly) return COMMAND_OK;
+
+  // A hold replaced before its first frame still gets that frame
+  if (holdRemoteId >= 0 && holdFrames == 0) queueTransmit(holdRemoteId, holdButtonId);
+
+  holdRemoteId = remoteId;
+  holdButtonId = buttonId;
+  holdStartedAt = millis();
+  holdRenewedAt = holdStartedAt;
+  holdRequestedAtUs = micros();
+  holdFrames = 0;
+  holdReleased = false;
+  return COMMAND_OK;
+}
+
+void endHold() {
+  holdRemoteId = -1;
+  holdButtonId = -1;
+  holdReleased = false;
+}
+
+// Every accepted hold sends at least one frame, so a tap released before the
+// first frame could go out (behind queued frames or the frame gap) still
+// sends it; the hold then ends once that frame is out
+void commandRelease() {
+  if (holdRemoteId >= 0 && holdFrames == 0) {
+    holdReleased = true;
+  } else {
+    endHold();
+  }
+}
+
+void serviceHold() {
+  if (holdRemoteId < 0) return;
+
+  unsigned long now = millis();
+  if (!isValidButton(holdRemoteId, holdButtonId) ||
+      !remotes[holdRemoteId].buttons[holdButtonId].signal.isValid) {
+    endHold();
+    return;
+  }
+  if (holdFrames > 0 && (holdReleased || now - holdRenewedAt > HOLD_LEASE_MS ||
+                         now - holdStartedAt > HOLD_MAX_MS)) {
+    endHold();
     return;
   }
 
-  DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
+  // Queued presses on the same emitter go first
+  int channelId = remotes[holdRemoteId].channel;
+  TransmitChannel& channel = channels[channelId];
+  if (channel.count > 0) return;
 
-  if (error) {
+  if (holdFrames == 0) {
+    if (now - channel.lastTransmitAt < TX_FRAME_GAP_MS) return;
+  } else if ((long)(now - holdNextFrameAt) < 0) {
+    return;
+  }
+
+  // Latency runs from when the frame was due to the end of the frame, as for
+  // queued frames; the first one was due when the hold was requested
+  unsigned long dueAtUs = holdFrames == 0 ? holdRequestedAtUs : micros() - (now - holdNextFrameAt) * 1000;
+  const IRSignal& signal = remotes[holdRemoteId].buttons[holdButtonId].signal;
+  holdNextFrameAt = now + holdPeriodMs(signal);
+
+  if (holdFrames > 0 && isNecLike(signal)) {
+    irsend[channelId]->sendRaw(NEC_REPEAT_FRAME, 3, IR_LED_FREQUENCY);
+  } else {
+    sendIRSignal(signal, channelId);
+  }
+  lastTransmitAt = millis();
+  channel.lastTransmitAt = lastTransmitAt;
+
+  uint32_t latencyUs = micros() - dueAtUs;
+  channel.frames++;
+  channel.latencySumUs += latencyUs;
+  channel.latencyMaxUs = max(channel.latencyMaxUs, latencyUs);
+  recordLaneLatency(LANE_REALTIME, latencyUs);
+  holdFrames++;
+}
+
+// Scheduler functions
+// Schedules hang off a hierarchical timer wheel with one-minute ticks. A
+// tick only empties one level-0 slot; every 64 ticks one level-1 slot is
+// cascaded down (and every 4096 ticks one level-2 slot), so idle schedules
+// cost nothing until they come due.
+bool clockIsSet() {
+  return time(nullptr) > (time_t)CLOCK_VALID_AFTER;
+}
+
+uint32_t currentMinute() {
+  return time(nullptr) / 60;
+}
+
+// First run strictly after afterMinute, or 0 when there is none
+uint32_t nextFireMinute(const Schedule& schedule, uint32_t afterMinute) {
+  if (schedule.type == SCHEDULE_ONCE) {
+    return schedule.fireMinute > afterMinute ? schedule.fireMinute : 0;
+  }
+
+  time_t after = (time_t)afterMinute * 60;
+  struct tm today;
+  localtime_r(&after, &today);
+
+  for (int day = 0; day <= 7; day++) {
+    struct tm candidate = today;
+    candidate.tm_mday += day;
+    candidate.tm_hour = schedule.minuteOfDay / 60;
+    candidate.tm_min = schedule.minuteOfDay % 60;
+    candidate.tm_sec = 0;
+    candidate.tm_isdst = -1;
+    uint32_t fireMinute = mktime(&candidate) / 60; // Also fills in tm_wday
+
+    if (fireMinute <= afterMinute) continue;
+    if (schedule.type == SCHEDULE_WEEKLY && !(schedule.weekdays & (1 << candidate.tm_wday))) continue;
+    return fireMinute;
+  }
+
+  return 0;
+}
+
+// Runs further ahead than the wheel spans stay on the top level and are simply
+// cascaded again until they come within range
+void wheelInsert(int index) {
+  Schedule& schedule = schedules[index];
+  uint32_t expire = max(schedule.fireMinute, wheelMinute); // Overdue runs go to the current slot
+  uint32_t delta = expire - wheelMinute;
+
+  int level = 0;
+  while (level < WHEEL_LEVELS - 1 && delta >= (1UL << (WHEEL_BITS * (level + 1)))) level++;
+  uint8_t slot = (expire >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+
+  schedule.next = wheel[level][slot];
+  wheel[level][slot] = index;
+}
+
+// Deleting is rare, so a scan of every slot list is fine here
+void wheelRemove(int index) {
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+      int16_t* link = &wheel[level][slot];
+      while (*link >= 0) {
+        if (*link == index) {
+          *link = schedules[index].next;
+          return;
+        }
+        link = &schedules[*link].next;
+      }
+    }
+  }
+}
+
+void wheelCascade(int level, uint8_t slot) {
+  int16_t index = wheel[level][slot];
+  wheel[level][slot] = -1;
+
+  while (index >= 0) {
+    int16_t next = schedules[index].next;
+    wheelInsert(index);
+    index = next;
+  }
+}
+
+// Puts every active schedule back on an empty wheel starting at minute now;
+// one-shot schedules missed in the meantime are dropped
+void rebuildWheel(uint32_t now) {
+  memset(wheel, 0xFF, sizeof(wheel)); // All slots -1
+  wheelMinute = now;
+  wheelStarted = true;
+
+  bool changed = false;
+  for (int i = 0; i < MAX_SCHEDULES; i++) {
+    if (!schedules[i].isActive) continue;
+
+    uint32_t fireMinute = nextFireMinute(schedules[i], now - 1);
+    if (fireMinute == 0) {
+      schedules[i].isActive = false;
+      changed = true;
+      continue;
+    }
+    schedules[i].fireMinute = fireMinute;
+    wheelInsert(i);
+  }
+
+  if (changed) requestSchedulesSave();
+}
+
+void fireSchedule(int index) {
+  Schedule& schedule = schedules[index];
+  MacroStep steps[MAX_SCHEDULE_STEPS];
+  for (int i = 0; i < schedule.stepCount; i++) {
+    steps[i].remoteId = schedule.steps[i].remoteId;
+    steps[i].buttonId = schedule.steps[i].buttonId;
+    steps[i].delayMs = schedule.steps[i].delayMs;
+  }
+
+  CommandResult result = commandMacro(steps, schedule.stepCount);
+  scheduleFireCount++;
+  Serial.print("Agendamento executado: ");
+  Serial.print(index);
+  if (result != COMMAND_OK) {
+    Serial.print(" - falhou: ");
+    Serial.print(commandError(result));
+  }
+  Serial.println();
+
+  if (schedule.type == SCHEDULE_ONCE) {
+    schedule.isActive = false;
+    requestSchedulesSave();
+    return;
+  }
+
+  schedule.fireMinute = nextFireMinute(schedule, wheelMinute);
+  wheelInsert(index);
+}
+
+void advanceWheel() {
+  uint8_t slot = wheelMinute & (WHEEL_SLOTS - 1);
+
+  if (slot == 0) {
+    uint8_t slot1 = (wheelMinute >> WHEEL_BITS) & (WHEEL_SLOTS - 1);
+    if (slot1 == 0) wheelCascade(2, (wheelMinute >> (2 * WHEEL_BITS)) & (WHEEL_SLOTS - 1));
+    wheelCascade(1, slot1);
+  }
+
+  int16_t index = wheel[0][slot];
+  wheel[0][slot] = -1;
+  while (index >= 0) {
+    int16_t next = schedules[index].next;
+    fireSchedule(index);
+    index = next;
+  }
+
+  wheelMinute++;
+}
+
+void serviceScheduler() {
+  if (!clockIsSet()) return;
+
+  uint32_t now = currentMinute();
+  if (!wheelStarted || now + WHEEL_MAX_CATCH_UP_MINUTES < wheelMinute ||
+      now > wheelMinute + WHEEL_MAX_CATCH_UP_MINUTES) {
+    rebuildWheel(now);
+  }
+
+  while (wheelMinute <= now) {
+    advanceWheel();
+  }
+}
+
+// Fleet functions
+// Every node advertises FLEET_SERVICE over mDNS under its own name, with its
+// room and registry size in the TXT record. A service query installed at
+// startup keeps fleetPeers up to date from the answers, which arrive in
+// MDNS.update(), so nothing waits on the network outside a fan-out.
+bool roomMatches(const char* room, const char* target) {
+  return strcmp(target, "*") == 0 || strcasecmp(room, target) == 0;
+}
+
+int countActiveRemotes() {
+  int activeRemotes = 0;
+  for (int i = 0; i < remoteCount; i++) {
+    if (remotes[i].isActive) activeRemotes++;
+  }
+  return activeRemotes;
+}
+
+int countActiveButtons() {
+  int buttons = 0;
+  for (int i = 0; i < remoteCount; i++) {
+    if (!remotes[i].isActive) continue;
+    for (int j = 0; j < remotes[i].buttonCount; j++) {
+      if (remotes[i].buttons[j].isActive) buttons++;
+    }
+  }
+  return buttons;
+}
+
+void buildFleetSummary(DynamicJsonDocument& doc) {
+  doc["node"] = nodeName;
+  doc["room"] = FLEET_ROOM;
+  doc["remotes"] = countActiveRemotes();
+  doc["buttons"] = countActiveButtons();
+}
+
+// Filled in each time the TXT record is sent, so peers see current sizes
+void updateFleetTxt(const MDNSResponder::hMDNSService service) {
+  MDNS.addDynamicServiceTxt(service, "remotes", (uint32_t)countActiveRemotes());
+  MDNS.addDynamicServiceTxt(service, "buttons", (uint32_t)countActiveButtons());
+}
+
+// Finds the peer with this instance name, or a free slot for it
+int findFleetPeer(const char* name, bool create) {
+  int freeSlot = -1;
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    if (fleetPeers[i].isActive && strcmp(fleetPeers[i].name, name) == 0) return i;
+    if (!fleetPeers[i].isActive && freeSlot < 0) freeSlot = i;
+  }
+  if (!create || freeSlot < 0) return -1;
+
+  FleetPeer& peer = fleetPeers[freeSlot];
+  strncpy(peer.name, name, sizeof(peer.name) - 1);
+  peer.name[sizeof(peer.name) - 1] = '\0';
+  peer.room[0] = '\0';
+  peer.ip = IPAddress();
+  peer.port = 0;
+  peer.remotes = 0;
+  peer.buttons = 0;
+  peer.isUnreachable = false;
+  peer.isActive = true;
+  return freeSlot;
+}
+
+// Called from MDNS.update() for every part of an answer that appears,
+// changes or expires
+void onFleetAnswer(MDNSResponder::MDNSServiceInfo info, MDNSResponder::AnswerType answerType, bool isSet) {
+  // The instance name is the first label of the service domain
+  char name[32];
+  const char* domain = info.serviceDomain();
+  size_t length = strcspn(domain, ".");
+  if (length >= sizeof(name)) return;
+  memcpy(name, domain, length);
+  name[length] = '\0';
+  if (strcmp(name, nodeName) == 0) return;
+
+  int slot = findFleetPeer(name, isSet);
+  if (slot < 0) return;
+  FleetPeer& peer = fleetPeers[slot];
+
+  if (answerType == MDNSResponder::AnswerType::ServiceDomain && !isSet) {
+    peer.isActive = false;
+    Serial.print("No saiu da rede: ");
+    Serial.println(name);
+    return;
+  }
+
+  if (answerType == MDNSResponder::AnswerType::HostDomainAndPort && isSet && info.hostPortAvailable()) {
+    peer.port = info.hostPort();
+  } else if (answerType == MDNSResponder::AnswerType::IP4Address) {
+    peer.ip = isSet && info.IP4AddressAvailable() ? info.IP4Adresses()[0] : IPAddress();
+    peer.isUnreachable = false; // A new address is worth another try
+  } else if (answerType == MDNSResponder::AnswerType::Txt && isSet && info.txtAvailable()) {
+    const char* room = info.value("room");
+    const char* remotesValue = info.value("remotes");
+    const char* buttonsValue = info.value("buttons");
+    strncpy(peer.room, room != nullptr ? room : "", MAX_NAME_LENGTH - 1);
+    peer.room[MAX_NAME_LENGTH - 1] = '\0';
+    peer.remotes = remotesValue != nullptr ? atoi(remotesValue) : 0;
+    peer.buttons = buttonsValue != nullptr ? atoi(buttonsValue) : 0;
+  }
+  peer.seenAt = millis();
+}
+
+// Sends a fresh query; answers already cached are reported again
+void startFleetQuery() {
+  if (fleetQuery != nullptr) MDNS.removeServiceQuery(fleetQuery);
+  fleetQuery = MDNS.installServiceQuery(FLEET_SERVICE, "tcp", onFleetAnswer);
+}
+
+bool isReachablePeer(const FleetPeer& peer) {
+  if (!peer.isActive || !peer.ip.isSet() || peer.port == 0) return false;
+  return !peer.isUnreachable || millis() - peer.failedAt >= FLEET_RETRY_MS;
+}
+
+// Sends the request to every selected peer before reading any reply, so the
+// total time is that of the slowest peer rather than the sum of all of them.
+// Connects are made one after the other with a short timeout, and a peer
+// whose connect fails is skipped for FLEET_RETRY_MS, so a node that left the
+// network costs one connect timeout rather than one per command. A peer that
+// connects but is slow to reply is only busy, and is tried again next time.
+// Queued frames keep going out while the replies are awaited.
+// Fills statusCodes (0 when a peer did not answer, -1 when it was skipped)
+// and latencies in ms.
+void fanOutToPeers(const bool* selected, const String& body, int* statusCodes, unsigned long* latencies) {
+  WiFiClient clients[MAX_FLEET_PEERS];
+  char statusLines[MAX_FLEET_PEERS][16];
+  uint8_t statusLengths[MAX_FLEET_PEERS] = {0};
+  bool pending[MAX_FLEET_PEERS] = {false};
+  bool connectFailed[MAX_FLEET_PEERS] = {false};
+  unsigned long startedAt = millis();
+
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    statusCodes[i] = 0;
+    latencies[i] = 0;
+    if (!selected[i]) continue;
+    if (!isReachablePeer(fleetPeers[i])) {
+      statusCodes[i] = -1;
+      continue;
+    }
+
+    clients[i].setTimeout(FLEET_CONNECT_TIMEOUT_MS);
+    if (!clients[i].connect(fleetPeers[i].ip, fleetPeers[i].port)) {
+      latencies[i] = millis() - startedAt;
+      connectFailed[i] = true;
+      continue;
+    }
+
+    clients[i].print("POST /api/fleet/local HTTP/1.1\r\nHost: ");
+    clients[i].print(fleetPeers[i].ip.toString());
+    clients[i].print("\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: ");
+    clients[i].print(body.length());
+    clients[i].print("\r\n\r\n");
+    clients[i].print(body);
+    pending[i] = true;
+  }
+
+  // Only the status line is needed: 200 means the peer queued the send
+  int remaining = 0;
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    if (pending[i]) remaining++;
+  }
+
+  while (remaining > 0 && millis() - startedAt < FLEET_TIMEOUT_MS) {
+    for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+      if (!pending[i]) continue;
+
+      bool lineDone = false;
+      while (clients[i].available() > 0 && !lineDone) {
+        char c = clients[i].read();
+        if (c == '\n') {
+          lineDone = true;
+        } else if (statusLengths[i] < sizeof(statusLines[i]) - 1) {
+          statusLines[i][statusLengths[i]++] = c;
+        }
+      }
+
+      if (lineDone || !clients[i].connected()) {
+        statusLines[i][statusLengths[i]] = '\0';
+        if (lineDone) sscanf(statusLines[i], "HTTP/%*s %d", &statusCodes[i]);
+        latencies[i] = millis() - startedAt;
+        clients[i].stop();
+        pending[i] = false;
+        remaining--;
+      }
+    }
+    serviceTransmitQueue();
+    yield();
+  }
+
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    if (pending[i]) {
+      clients[i].stop();
+      latencies[i] = millis() - startedAt;
+    }
+    if (!selected[i] || statusCodes[i] < 0) continue;
+    fleetPeers[i].isUnreachable = connectFailed[i];
+    if (connectFailed[i]) fleetPeers[i].failedAt = millis();
+  }
+}
+
+// Metrics functions
+void buildMetrics(DynamicJsonDocument& doc) {
+  static const char* laneNames[LANE_COUNT] = {"realtime", "management"};
+
+  doc["uptimeMs"] = millis();
+  doc["txQueue"] = pendingTransmits();
+
+  JsonArray channelsArray = doc.createNestedArray("channels");
+  for (int c = 0; c < IR_CHANNEL_COUNT; c++) {
+    JsonObject channelObj = channelsArray.createNestedObject();
+    channelObj["queued"] = channels[c].count;
+    channelObj["frames"] = channels[c].frames;
+    channelObj["avgLatencyUs"] = channels[c].frames > 0 ? (uint32_t)(channels[c].latencySumUs / channels[c].frames) : 0;
+    channelObj["maxLatencyUs"] = channels[c].latencyMaxUs;
+  }
+
+  JsonObject lanesObj = doc.createNestedObject("lanes");
+  for (int i = 0; i < LANE_COUNT; i++) {
+    JsonObject laneObj = lanesObj.createNestedObject(laneNames[i]);
+    uint32_t samples = laneStats[i].latencySamples;
+    laneObj["requests"] = laneStats[i].requests;
+    laneObj["shed"] = laneStats[i].shed;
+    laneObj["avgLatencyUs"] = samples > 0 ? (uint32_t)(laneStats[i].latencySumUs / samples) : 0;
+    laneObj["maxLatencyUs"] = laneStats[i].latencyMaxUs;
+  }
+
+  JsonObject savesObj = doc.createNestedObject("saves");
+  savesObj["count"] = saveCount;
+  savesObj["pending"] = saveRequested || schedulesSaveRequested;
+  savesObj["lastDurationMs"] = lastSaveDurationMs;
+  savesObj["flashBytes"] = flashBytesWritten;
+  savesObj["bootLoadMs"] = bootLoadMs;
+  savesObj["blocked"] = savesBlocked;
+
+  // Fragmentation shows up as a largest block well below the free total
+  JsonObject heapObj = doc.createNestedObject("heap");
+  heapObj["free"] = ESP.getFreeHeap();
+  heapObj["maxBlock"] = ESP.getMaxFreeBlockSize();
+  heapObj["fragmentation"] = ESP.getHeapFragmentation();
+
+  JsonObject schedulerObj = doc.createNestedObject("scheduler");
+  schedulerObj["clockSet"] = clockIsSet();
+  schedulerObj["fired"] = scheduleFireCount;
+}
+
+// Serial command functions
+// One command per line, answered with a line starting with "OK" or "ERR" so
+// a host can tell replies apart from the log output:
+//   LIST | SEND <remote> <button> | MACRO <remote>:<button>[:<delayMs>] ...
+//   HOLD <remote> <button> (repeat within 400ms to keep holding) | RELEASE
+//   REC <remote> <button> | STOP | METRICS
+// JSON replies longer than SERIAL_REPLY_CHUNK come as "OK+ <part>" lines
+// ending with an "OK <part>" line; the JSON is the parts joined together.
+bool parseSerialInt(const char* token, int& value) {
+  if (token == nullptr) return false;
+
+  char* end;
+  long parsed = strtol(token, &end, 10);
+  if (end == token || *end != '\0') return false;
+
+  value = parsed;
+  return true;
+}
+
+void serialReply(CommandResult result) {
+  if (result == COMMAND_OK) {
+    Serial.println("OK");
+  } else {
+    Serial.print("ERR ");
+    Serial.println(commandError(result));
+  }
+}
+
+// The reply is written from loop() by serviceSerialReply(), so a long one
+// never blocks the loop until the UART has sent it all
+void serialReplyJson(DynamicJsonDocument& doc) {
+  serialReplyText = String();
+  serialReplySent = 0;
+  serializeJson(doc, serialReplyText);
+}
+
+// Writes whole reply lines while the UART FIFO can take them without
+// waiting; at 115200 baud a full remote list takes most of a second
+void serviceSerialReply() {
+  while (serialReplySent < serialReplyText.length()) {
+    size_t remaining = serialReplyText.length() - serialReplySent;
+    size_t size = min(remaining, (size_t)SERIAL_REPLY_CHUNK);
+    bool isLast = size == remaining;
+    if (Serial.availableForWrite() < (int)size + 6) return; // Prefix and line end
+
+    Serial.print(isLast ? "OK " : "OK+ ");
+    Serial.write(serialReplyText.c_str() + serialReplySent, size);
+    Serial.println();
+    serialReplySent += size;
+  }
+
+  if (serialReplyText.length() > 0) serialReplyText = String();
+}
+
+void runSerialCommand(char* line) {
+  char* command = strtok(line, " ");
+  int remoteId;
+  int buttonId;
+
+  if (command == nullptr) return;
+
+  if (strcasecmp(command, "LIST") == 0) {
+    DynamicJsonDocument doc(4096);
+    buildRemotesList(doc);
+    serialReplyJson(doc);
+  } else if (strcasecmp(command, "SEND") == 0) {
+    if (!parseSerialInt(strtok(nullptr, " "), remoteId) || !parseSerialInt(strtok(nullptr, " "), buttonId)) {
+      Serial.println("ERR Usage: SEND <remote> <button>");
+      return;
+    }
+    serialReply(commandSend(remoteId, buttonId));
+  } else if (strcasecmp(command, "HOLD") == 0) {
+    if (!parseSerialInt(strtok(nullptr, " "), remoteId) || !parseSerialInt(strtok(nullptr, " "), buttonId)) {
+      Serial.println("ERR Usage: HOLD <remote> <button>");
+      return;
+    }
+    serialReply(commandHold(remoteId, buttonId, false));
+  } else if (strcasecmp(command, "RELEASE") == 0) {
+    commandRelease();
+    serialReply(COMMAND_OK);
+  } else if (strcasecmp(command, "MACRO") == 0) {
+    MacroStep steps[TX_QUEUE_SIZE];
+    int count = 0;
+
+    for (char* token = strtok(nullptr, " "); token != nullptr; token = strtok(nullptr, " ")) {
+      char* end = token;
+      long values[3] = {-1, -1, 0};
+      int parsed = 0;
+      bool valid = true;
+      while (parsed < 3) {
+        values[parsed] = strtol(token, &end, 10);
+        if (end == token) {
+          valid = false;
+          break;
+        }
+        parsed++;
+        if (*end != ':') break;
+        token = end + 1;
+      }
+
+      if (count >= TX_QUEUE_SIZE) {
+        serialReply(COMMAND_TOO_MANY_STEPS);
+        return;
+      }
+      if (!valid || *end != '\0' || parsed < 2 || values[2] < 0 || values[2] > MAX_MACRO_DELAY_MS) {
+        Serial.println("ERR Usage: MACRO <remote>:<button>[:<delayMs>] ...");
+        return;
+      }
+      steps[count].remoteId = values[0];
+      steps[count].buttonId = values[1];
+      steps[count].delayMs = values[2];
+      count++;
+    }
+    serialReply(commandMacro(steps, count));
+  } else if (strcasecmp(command, "REC") == 0) {
+    if (!parseSerialInt(strtok(nullptr, " "), remoteId) || !parseSerialInt(strtok(nullptr, " "), buttonId)) {
+      Serial.println("ERR Usage: REC <remote> <button>");
+      return;
+    }
+    serialReply(commandStartRecording(remoteId, buttonId));
+  } else if (strcasecmp(command, "STOP") == 0) {
+    commandStopRecording();
+    serialReply(COMMAND_OK);
+  } else if (strcasecmp(command, "METRICS") == 0) {
+    DynamicJsonDocument doc(1024);
+    buildMetrics(doc);
+    serialReplyJson(doc);
+  } else {
+    Serial.println("ERR Unknown command");
+  }
+}
+
+// Consumes whatever the UART has buffered without waiting for more, so a
+// partial line never blocks loop(). Commands wait in the UART buffer while
+// a reply is still being written, so replies never interleave.
+void serviceSerialCommands() {
+  serviceSerialReply();
+  if (serialReplyText.length() > 0) return;
+
+  int budget = SERIAL_COMMAND_MAX_LENGTH; // Bounded so a flood of input cannot starve the loop
+
+  while (Serial.available() > 0 && budget-- > 0 && serialReplyText.length() == 0) {
+    char c = Serial.read();
+
+    if (c == '\r' || c == '\n') {
+      if (serialCommandOverflow) {
+        Serial.println("ERR Line too long");
+      } else if (serialCommandLength > 0) {
+        serialCommand[serialCommandLength] = '\0';
+        runSerialCommand(serialCommand);
+      }
+      serialCommandLength = 0;
+      serialCommandOverflow = false;
+    } else if (serialCommandLength < SERIAL_COMMAND_MAX_LENGTH - 1) {
+      serialCommand[serialCommandLength++] = c;
+    } else {
+      serialCommandOverflow = true;
+    }
+  }
+}
+
+// HTTP Handlers
+// Bodies are size-checked before parsing, since the document grows with its
+// input; request bodies are flat apart from the macro and schedule steps
+bool parseRequestBody(DynamicJsonDocument& doc) {
+  if (requestBodyReceived && requestBodyTooLarge) {
+    server.send(413, "application/json", "{\"error\":\"Body too large\"}");
+    return false;
+  }
+  if (!requestBodyReceived || requestBodyLength == 0) {
+    server.send(400, "application/json", "{\"error\":\"No body\"}");
+    return false;
+  }
+
+  requestBody[requestBodyLength] = '\0';
+  if (deserializeJson(doc, requestBody, requestBodyLength, DeserializationOption::NestingLimit(3))) {
     server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+    return false;
+  }
+  return true;
+}
+
+void sendCommandResponse(CommandResult result, const char* successJson) {
+  if (result == COMMAND_OK) {
+    server.send(200, "application/json", successJson);
     return;
   }
 
+  DynamicJsonDocument responseDoc(128);
+  responseDoc["error"] = commandError(result);
+  String response;
+  serializeJson(responseDoc, response);
+  int statusCode = 400;
+  if (result == COMMAND_QUEUE_FULL) statusCode = 503;
+  if (result == COMMAND_NO_MATCH) statusCode = 404;
+  server.send(statusCode, "application/json", response);
+}
+
+void handleRoot() {
+  server.send(200, "text/html", HTML_CONTENT);
+}
+
+void handleGetRemotes() {
+  DynamicJsonDocument doc(4096);
+  buildRemotesList(doc);
+
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+void handleAddRemote() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
   const char* name = doc["name"];
   int id = addRemote(name);
 
   if (id >= 0) {
-    saveData(); // Save to flash
+    requestSave(); // Save to flash from loop()
     DynamicJsonDocument responseDoc(128);
     responseDoc["success"] = true;
     responseDoc["id"] = id;
@@ -302,30 +2269,20 @@ void handleAddRemote() {
     serializeJson(responseDoc, response);
     server.send(200, "application/json", response);
   } else {
-    server.send(500, "application/json", "{\"error\":\"Failed to add remote\"}");
-  }
-}
-
-void handleAddButton() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
-    return;
-  }
-
-  DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
-
-  if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
-    return;
+    server.send(500, "application/json", "{\"error\":\"Failed to add remote\"}");
   }
+}
+
+void handleAddButton() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
 
   int remoteId = doc["remoteId"];
   const char* name = doc["name"];
   int buttonId = addButton(remoteId, name);
 
   if (buttonId >= 0) {
-    saveData(); // Save to flash
+    requestSave(); // Save to flash from loop()
     DynamicJsonDocument responseDoc(128);
     responseDoc["success"] = true;
     responseDoc["id"] = buttonId;
@@ -338,86 +2295,282 @@ void handleAddButton() {
 }
 
 void handleStartRecording() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
-    return;
-  }
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
+  CommandResult result = commandStartRecording(doc["remoteId"] | -1, doc["buttonId"] | -1);
+  sendCommandResponse(result, "{\"success\":true,\"message\":\"Recording started\"}");
+}
+
+void handleStopRecording() {
+  commandStopRecording();
+  server.send(200, "application/json", "{\"success\":true,\"message\":\"Recording stopped\"}");
+}
+
+void handleSendSignal() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
+  CommandResult result = commandSend(doc["remoteId"] | -1, doc["buttonId"] | -1);
+  sendCommandResponse(result, "{\"success\":true,\"message\":\"Signal queued\"}");
+}
 
+// Starts or renews a hold; the browser renews it while the button is pressed
+void handleHoldSignal() {
   DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
+  if (!parseRequestBody(doc)) return;
 
-  if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+  CommandResult result = commandHold(doc["remoteId"] | -1, doc["buttonId"] | -1, doc["renew"] | false);
+  sendCommandResponse(result, "{\"success\":true,\"message\":\"Holding\"}");
+}
+
+void handleReleaseSignal() {
+  commandRelease();
+  server.send(200, "application/json", "{\"success\":true}");
+}
+
+void handleSendMacro() {
+  DynamicJsonDocument doc(1024);
+  if (!parseRequestBody(doc)) return;
+
+  JsonArray stepsArray = doc["steps"];
+  if (stepsArray.size() > TX_QUEUE_SIZE) {
+    sendCommandResponse(COMMAND_TOO_MANY_STEPS, "");
     return;
   }
 
-  recordingRemoteId = doc["remoteId"];
-  recordingButtonId = doc["buttonId"];
-  recordingMode = true;
-
-  // Clear IR buffer
-  irrecv.resume();
+  MacroStep steps[TX_QUEUE_SIZE];
+  int count = 0;
+  for (JsonObject stepObj : stepsArray) {
+    int delayMs = stepObj["delayMs"] | 0;
+    steps[count].remoteId = stepObj["remoteId"] | -1;
+    steps[count].buttonId = stepObj["buttonId"] | -1;
+    steps[count].delayMs = constrain(delayMs, 0, MAX_MACRO_DELAY_MS + 1); // Out of range fails validation
+    count++;
+  }
 
-  server.send(200, "application/json", "{\"success\":true,\"message\":\"Recording started\"}");
-  Serial.println("Modo de gravacao iniciado");
+  sendCommandResponse(commandMacro(steps, count), "{\"success\":true,\"message\":\"Macro queued\"}");
 }
 
-void handleStopRecording() {
-  recordingMode = false;
-  recordingRemoteId = -1;
-  recordingButtonId = -1;
+void handleGetSchedules() {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  // Streamed, since a full list does not fit a JsonDocument on this board
+  ChunkedResponse out;
+  DynamicJsonDocument doc(512);
+  out.print("{\"clockSet\":");
+  out.print(clockIsSet() ? "true" : "false");
+  out.print(",\"now\":");
+  out.print((unsigned long)time(nullptr));
+  out.print(",\"schedules\":[");
+
+  bool first = true;
+  for (int i = 0; i < MAX_SCHEDULES; i++) {
+    if (!schedules[i].isActive) continue;
+    if (!first) out.print(',');
+    writeScheduleRecord(out, i, doc);
+    first = false;
+  }
 
-  server.send(200, "application/json", "{\"success\":true,\"message\":\"Recording stopped\"}");
-  Serial.println("Modo de gravacao parado");
+  out.print("]}");
+  out.flush();
+  server.sendContent(""); // Last chunk
 }
 
-void handleSendSignal() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
+void handleAddSchedule() {
+  DynamicJsonDocument doc(1024);
+  if (!parseRequestBody(doc)) return;
+
+  Schedule schedule;
+  if (!parseSchedule(doc.as<JsonObject>(), schedule)) {
+    server.send(400, "application/json", "{\"error\":\"Invalid schedule\"}");
     return;
   }
 
-  DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
+  for (int i = 0; i < schedule.stepCount; i++) {
+    if (!isValidButton(schedule.steps[i].remoteId, schedule.steps[i].buttonId)) {
+      sendCommandResponse(COMMAND_INVALID_STEP, "");
+      return;
+    }
+  }
 
-  if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+  int id = -1;
+  for (int i = 0; i < MAX_SCHEDULES && id < 0; i++) {
+    if (!schedules[i].isActive) id = i;
+  }
+  if (id < 0) {
+    server.send(500, "application/json", "{\"error\":\"Too many schedules\"}");
     return;
   }
 
-  int remoteId = doc["remoteId"];
-  int buttonId = doc["buttonId"];
+  // Only fully known once the clock is set; rebuildWheel() covers the rest
+  if (wheelStarted) {
+    uint32_t fireMinute = nextFireMinute(schedule, currentMinute());
+    if (fireMinute == 0) {
+      server.send(400, "application/json", "{\"error\":\"Schedule is in the past\"}");
+      return;
+    }
+    schedule.fireMinute = fireMinute;
+    schedules[id] = schedule;
+    wheelInsert(id);
+  } else {
+    schedules[id] = schedule;
+  }
+  requestSchedulesSave();
 
-  if (remoteId >= 0 && remoteId < remoteCount &&
-      buttonId >= 0 && buttonId < remotes[remoteId].buttonCount) {
+  DynamicJsonDocument responseDoc(128);
+  responseDoc["success"] = true;
+  responseDoc["id"] = id;
+  String response;
+  serializeJson(responseDoc, response);
+  server.send(200, "application/json", response);
+}
 
-    IRSignal signal = remotes[remoteId].buttons[buttonId].signal;
-    if (signal.isValid) {
-      sendIRSignal(signal);
-      server.send(200, "application/json", "{\"success\":true,\"message\":\"Signal sent\"}");
-      Serial.println("Sinal IR enviado");
-    } else {
-      server.send(400, "application/json", "{\"error\":\"No signal recorded for this button\"}");
-    }
+void handleDeleteSchedule() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
+  int scheduleId = doc["scheduleId"] | -1;
+
+  if (scheduleId >= 0 && scheduleId < MAX_SCHEDULES && schedules[scheduleId].isActive) {
+    if (wheelStarted) wheelRemove(scheduleId);
+    schedules[scheduleId].isActive = false;
+    requestSchedulesSave();
+    server.send(200, "application/json", "{\"success\":true}");
   } else {
-    server.send(400, "application/json", "{\"error\":\"Invalid remote or button ID\"}");
+    server.send(400, "application/json", "{\"error\":\"Invalid schedule ID\"}");
   }
 }
 
-void handleDeleteRemote() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
-    return;
+void handleGetFleet() {
+  DynamicJsonDocument doc(3072);
+  doc["node"] = nodeName;
+  doc["room"] = FLEET_ROOM;
+
+  JsonArray peersArray = doc.createNestedArray("peers");
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    if (!fleetPeers[i].isActive) continue;
+
+    JsonObject peerObj = peersArray.createNestedObject();
+    peerObj["node"] = fleetPeers[i].name;
+    peerObj["ip"] = fleetPeers[i].ip.toString();
+    peerObj["room"] = fleetPeers[i].room;
+    peerObj["remotes"] = fleetPeers[i].remotes;
+    peerObj["buttons"] = fleetPeers[i].buttons;
+    peerObj["ageMs"] = millis() - fleetPeers[i].seenAt;
+    peerObj["reachable"] = isReachablePeer(fleetPeers[i]);
+  }
+
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+// Answers come in over the next seconds; the list returned is the current one
+void handleFleetDiscover() {
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    fleetPeers[i].isUnreachable = false;
   }
+  if (mdnsStarted) startFleetQuery();
+  handleGetFleet();
+}
 
+void handleFleetSummary() {
   DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
+  buildFleetSummary(doc);
 
-  if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+// Runs a fanned-out command on this node only
+void handleFleetLocal() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
+  int matched;
+  CommandResult result = commandSendByName(doc["remote"], doc["button"], matched);
+  sendCommandResponse(result, "{\"success\":true,\"message\":\"Signal queued\"}");
+}
+
+void handleFleetSend() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
+  const char* room = doc["room"] | "*";
+  const char* remoteName = doc["remote"];
+  const char* buttonName = doc["button"];
+  if (buttonName == nullptr) {
+    server.send(400, "application/json", "{\"error\":\"Missing button\"}");
     return;
   }
 
+  // Queued before the fan-out, so this node's frame goes out while the peers
+  // are being contacted
+  int matched = 0;
+  CommandResult localResult = COMMAND_OK;
+  bool sendLocally = roomMatches(FLEET_ROOM, room);
+  if (sendLocally) localResult = commandSendByName(remoteName, buttonName, matched);
+
+  DynamicJsonDocument commandDoc(256);
+  commandDoc["button"] = buttonName;
+  if (remoteName != nullptr) commandDoc["remote"] = remoteName;
+  String body;
+  serializeJson(commandDoc, body);
+
+  bool selected[MAX_FLEET_PEERS];
+  int statusCodes[MAX_FLEET_PEERS];
+  unsigned long latencies[MAX_FLEET_PEERS];
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    selected[i] = fleetPeers[i].isActive && roomMatches(fleetPeers[i].room, room);
+  }
+  fanOutToPeers(selected, body, statusCodes, latencies);
+
+  DynamicJsonDocument responseDoc(3072);
+  JsonArray resultsArray = responseDoc.createNestedArray("results");
+
+  if (sendLocally) {
+    JsonObject resultObj = resultsArray.createNestedObject();
+    resultObj["node"] = nodeName;
+    resultObj["ok"] = localResult == COMMAND_OK;
+    resultObj["matched"] = matched;
+    if (localResult != COMMAND_OK) resultObj["error"] = commandError(localResult);
+  }
+
+  for (int i = 0; i < MAX_FLEET_PEERS; i++) {
+    if (!selected[i]) continue;
+
+    JsonObject resultObj = resultsArray.createNestedObject();
+    resultObj["node"] = fleetPeers[i].name;
+    resultObj["ok"] = statusCodes[i] == 200;
+    if (statusCodes[i] < 0) {
+      resultObj["error"] = "Unreachable, skipped";
+      continue;
+    }
+    resultObj["status"] = statusCodes[i];
+    resultObj["latencyMs"] = latencies[i];
+  }
+
+  String response;
+  serializeJson(responseDoc, response);
+  server.send(200, "application/json", response);
+}
+
+void handleGetMetrics() {
+  DynamicJsonDocument doc(1024);
+  buildMetrics(doc);
+
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+void handleDeleteRemote() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
   int remoteId = doc["remoteId"];
 
   if (remoteId >= 0 && remoteId < remoteCount) {
@@ -425,10 +2578,12 @@ void handleDeleteRemote() {
     for (int i = 0; i < remotes[remoteId].buttonCount; i++) {
       if (remotes[remoteId].buttons[i].signal.data != nullptr) {
         delete[] remotes[remoteId].buttons[i].signal.data;
+        remotes[remoteId].buttons[i].signal.data = nullptr;
       }
     }
     remotes[remoteId].isActive = false;
-    saveData(); // Save to flash
+    rebuildFingerprintIndex();
+    requestSave(); // Save to flash from loop()
     server.send(200, "application/json", "{\"success\":true}");
   } else {
     server.send(400, "application/json", "{\"error\":\"Invalid remote ID\"}");
@@ -436,26 +2591,24 @@ void handleDeleteRemote() {
 }
 
 void handleEditRemote() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
-    return;
-  }
-
   DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
-
-  if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
-    return;
-  }
+  if (!parseRequestBody(doc)) return;
 
   int remoteId = doc["remoteId"];
   const char* name = doc["name"];
-
-  if (remoteId >= 0 && remoteId < remoteCount && name != nullptr) {
-    strncpy(remotes[remoteId].name, name, MAX_NAME_LENGTH - 1);
-    remotes[remoteId].name[MAX_NAME_LENGTH - 1] = '\0';
-    saveData(); // Save to flash
+  bool hasChannel = doc.containsKey("channel");
+  int channel = doc["channel"] | -1;
+
+  if (remoteId >= 0 && remoteId < remoteCount && (name != nullptr || hasChannel) &&
+      (!hasChannel || (channel >= 0 && channel < IR_CHANNEL_COUNT))) {
+    if (name != nullptr) {
+      strncpy(remotes[remoteId].name, name, MAX_NAME_LENGTH - 1);
+      remotes[remoteId].name[MAX_NAME_LENGTH - 1] = '\0';
+    }
+    // Frames already queued for this remote still go out on the old
+    // channel; only later sends use the new one
+    if (hasChannel) remotes[remoteId].channel = channel;
+    requestSave(); // Save to flash from loop()
     server.send(200, "application/json", "{\"success\":true}");
   } else {
     server.send(400, "application/json", "{\"error\":\"Invalid parameters\"}");
@@ -463,18 +2616,8 @@ void handleEditRemote() {
 }
 
 void handleDeleteButton() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
-    return;
-  }
-
   DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
-
-  if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
-    return;
-  }
+  if (!parseRequestBody(doc)) return;
 
   int remoteId = doc["remoteId"];
   int buttonId = doc["buttonId"];
@@ -484,9 +2627,11 @@ void handleDeleteButton() {
 
     if (remotes[remoteId].buttons[buttonId].signal.data != nullptr) {
       delete[] remotes[remoteId].buttons[buttonId].signal.data;
+      remotes[remoteId].buttons[buttonId].signal.data = nullptr;
     }
     remotes[remoteId].buttons[buttonId].isActive = false;
-    saveData(); // Save to flash
+    rebuildFingerprintIndex();
+    requestSave(); // Save to flash from loop()
     server.send(200, "application/json", "{\"success\":true}");
   } else {
     server.send(400, "application/json", "{\"error\":\"Invalid parameters\"}");
@@ -494,18 +2639,8 @@ void handleDeleteButton() {
 }
 
 void handleEditButton() {
-  if (!server.hasArg("plain")) {
-    server.send(400, "application/json", "{\"error\":\"No body\"}");
-    return;
-  }
-
   DynamicJsonDocument doc(256);
-  DeserializationError error = deserializeJson(doc, server.arg("plain"));
-
-  if (error) {
-    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
-    return;
-  }
+  if (!parseRequestBody(doc)) return;
 
   int remoteId = doc["remoteId"];
   int buttonId = doc["buttonId"];
@@ -517,13 +2652,289 @@ void handleEditButton() {
 
     strncpy(remotes[remoteId].buttons[buttonId].name, name, MAX_NAME_LENGTH - 1);
     remotes[remoteId].buttons[buttonId].name[MAX_NAME_LENGTH - 1] = '\0';
-    saveData(); // Save to flash
+    requestSave(); // Save to flash from loop()
     server.send(200, "application/json", "{\"success\":true}");
   } else {
     server.send(400, "application/json", "{\"error\":\"Invalid parameters\"}");
   }
 }
 
+void handleStartListening() {
+  listenMode = true;
+
+  // Clear IR buffer
+  irrecv.resume();
+
+  server.send(200, "application/json", "{\"success\":true,\"message\":\"Listening started\"}");
+  Serial.println("Modo de escuta iniciado");
+}
+
+void handleStopListening() {
+  listenMode = false;
+
+  server.send(200, "application/json", "{\"success\":true,\"message\":\"Listening stopped\"}");
+  Serial.println("Modo de escuta parado");
+}
+
+void handleGetListenStatus() {
+  DynamicJsonDocument doc(512);
+  doc["listening"] = listenMode;
+  doc["frames"] = listenFrameCount;
+  doc["matches"] = listenMatchCount;
+
+  if (lastMatchRemoteId >= 0 && lastMatchRemoteId < remoteCount &&
+      remotes[lastMatchRemoteId].isActive &&
+      lastMatchButtonId >= 0 && lastMatchButtonId < remotes[lastMatchRemoteId].buttonCount &&
+      remotes[lastMatchRemoteId].buttons[lastMatchButtonId].isActive) {
+    JsonObject lastMatch = doc.createNestedObject("lastMatch");
+    lastMatch["remoteId"] = lastMatchRemoteId;
+    lastMatch["buttonId"] = lastMatchButtonId;
+    lastMatch["remoteName"] = remotes[lastMatchRemoteId].name;
+    lastMatch["buttonName"] = remotes[lastMatchRemoteId].buttons[lastMatchButtonId].name;
+    lastMatch["fingerprint"] = lastMatchFingerprint;
+    lastMatch["ageMs"] = millis() - lastMatchAt;
+  }
+
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+void handleGetLibrary() {
+  DynamicJsonDocument doc(1024);
+  doc["codes"] = LIBRARY_CODE_COUNT;
+  char name[LIBRARY_NAME_LENGTH];
+
+  JsonArray brandsArray = doc.createNestedArray("brands");
+  for (int i = 0; i < LIBRARY_BRAND_COUNT; i++) {
+    strncpy_P(name, LIBRARY_BRAND_NAMES[i], LIBRARY_NAME_LENGTH);
+    brandsArray.add((char*)name);
+  }
+
+  JsonArray devicesArray = doc.createNestedArray("devices");
+  for (int i = 0; i < LIBRARY_DEVICE_COUNT; i++) {
+    strncpy_P(name, LIBRARY_DEVICE_NAMES[i], LIBRARY_NAME_LENGTH);
+    devicesArray.add((char*)name);
+  }
+
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+void handleLibrarySearch() {
+  int brand = -1;
+  int device = -1;
+  String function = server.arg("function");
+
+  if (server.arg("brand").length() > 0) {
+    brand = findLibraryBrand(server.arg("brand").c_str());
+    if (brand < 0) {
+      server.send(200, "application/json", "{\"total\":0,\"results\":[]}");
+      return;
+    }
+  }
+
+  if (server.arg("device").length() > 0) {
+    device = findLibraryDevice(server.arg("device").c_str());
+    if (device < 0) {
+      server.send(400, "application/json", "{\"error\":\"Invalid device\"}");
+      return;
+    }
+  }
+
+  uint32_t functions = matchLibraryFunctions(function.c_str());
+
+  // A brand narrows the scan to its slice of the table, a device to its list
+  // in the device index; only a search by function alone scans every code
+  uint16_t first = 0;
+  uint16_t last = functions != 0 ? LIBRARY_CODE_COUNT : 0;
+  bool byDevice = false;
+  if (brand >= 0) {
+    first = pgm_read_word(&LIBRARY_BRAND_INDEX.start[brand]);
+    last = functions != 0 ? pgm_read_word(&LIBRARY_BRAND_INDEX.start[brand + 1]) : first;
+  } else if (device >= 0) {
+    first = pgm_read_word(&LIBRARY_DEVICE_INDEX.start[device]);
+    last = functions != 0 ? pgm_read_word(&LIBRARY_DEVICE_INDEX.start[device + 1]) : first;
+    byDevice = true;
+  }
+
+  DynamicJsonDocument doc(4096);
+  JsonArray resultsArray = doc.createNestedArray("results");
+  char name[LIBRARY_NAME_LENGTH];
+  int total = 0;
+
+  for (uint16_t n = first; n < last; n++) {
+    uint16_t i = byDevice ? pgm_read_word(&LIBRARY_DEVICE_INDEX.codes[n]) : n;
+    LibraryCode code = readLibraryCode(i);
+    if (device >= 0 && code.device != device) continue;
+    if ((functions & (1UL << code.function)) == 0) continue;
+
+    total++;
+    if (resultsArray.size() >= LIBRARY_SEARCH_LIMIT) continue;
+
+    JsonObject resultObj = resultsArray.createNestedObject();
+    resultObj["id"] = i;
+    strncpy_P(name, LIBRARY_BRAND_NAMES[code.brand], LIBRARY_NAME_LENGTH);
+    resultObj["brand"] = (char*)name;
+    strncpy_P(name, LIBRARY_DEVICE_NAMES[code.device], LIBRARY_NAME_LENGTH);
+    resultObj["device"] = (char*)name;
+    strncpy_P(name, LIBRARY_FUNCTION_NAMES[code.function], LIBRARY_NAME_LENGTH);
+    resultObj["function"] = (char*)name;
+  }
+  doc["total"] = total;
+
+  String response;
+  serializeJson(doc, response);
+  server.send(200, "application/json", response);
+}
+
+void handleLibraryAdd() {
+  DynamicJsonDocument doc(256);
+  if (!parseRequestBody(doc)) return;
+
+  int remoteId = doc["remoteId"];
+  int codeId = doc["codeId"] | -1;
+  const char* name = doc["name"];
+
+  if (remoteId < 0 || remoteId >= remoteCount || !remotes[remoteId].isActive ||
+      codeId < 0 || codeId >= LIBRARY_CODE_COUNT) {
+    server.send(400, "application/json", "{\"error\":\"Invalid remote or code ID\"}");
+    return;
+  }
+
+  // Default to the function name, e.g. "Volume +"
+  char functionName[LIBRARY_NAME_LENGTH];
+  if (name == nullptr || name[0] == '\0') {
+    strncpy_P(functionName, LIBRARY_FUNCTION_NAMES[readLibraryCode(codeId).function], LIBRARY_NAME_LENGTH);
+    name = functionName;
+  }
+
+  int buttonId = addButton(remoteId, name);
+
+  if (buttonId >= 0) {
+    IRSignal& signal = remotes[remoteId].buttons[buttonId].signal;
+    signal.libraryCode = codeId;
+    signal.isValid = true;
+    rebuildFingerprintIndex();
+    requestSave(); // Save to flash from loop()
+
+    DynamicJsonDocument responseDoc(128);
+    responseDoc["success"] = true;
+    responseDoc["id"] = buttonId;
+    String response;
+    serializeJson(responseDoc, response);
+    server.send(200, "application/json", response);
+  } else {
+    server.send(500, "application/json", "{\"error\":\"Failed to add button\"}");
+  }
+}
+
+void handleBackup() {
+  server.sendHeader("Content-Disposition", "attachment; filename=\"ir-remote-backup.ndjson\"");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/x-ndjson", "");
+
+  ChunkedResponse out;
+  writeBackup(out, true);
+  out.flush();
+  server.sendContent(""); // Last chunk
+  Serial.println("Backup enviado");
+}
+
+// The request body is streamed to a temporary file as it arrives, so the
+// upload size never depends on free RAM
+File restoreFile;
+bool restoreUploadFailed = false;
+
+void handleRestoreUpload() {
+  HTTPRaw& raw = server.raw();
+
+  if (raw.status == RAW_START) {
+    restoreFile = LittleFS.open(RESTORE_TEMP_PATH, "w");
+    restoreUploadFailed = !restoreFile;
+  } else if (raw.status == RAW_WRITE) {
+    if (!restoreUploadFailed && restoreFile.write(raw.buf, raw.currentSize) != raw.currentSize) {
+      restoreUploadFailed = true;
+    }
+  } else if (raw.status == RAW_END || raw.status == RAW_ABORTED) {
+    if (restoreFile) restoreFile.close();
+    if (raw.status == RAW_ABORTED) restoreUploadFailed = true;
+  }
+}
+
+void handleRestore() {
+  if (restoreUploadFailed || !LittleFS.exists(RESTORE_TEMP_PATH)) {
+    LittleFS.remove(RESTORE_TEMP_PATH);
+    server.send(400, "application/json", "{\"error\":\"Upload failed\"}");
+    return;
+  }
+
+  // Validate everything before touching the registry
+  const char* error = nullptr;
+  File file = LittleFS.open(RESTORE_TEMP_PATH, "r");
+  bool valid = file && readBackup(file, false, error);
+  if (file) file.close();
+
+  if (!valid) {
+    LittleFS.remove(RESTORE_TEMP_PATH);
+    DynamicJsonDocument responseDoc(128);
+    responseDoc["error"] = error != nullptr ? error : "Failed to read backup";
+    String response;
+    serializeJson(responseDoc, response);
+    server.send(400, "application/json", response);
+    return;
+  }
+
+  // Edits still waiting for their deferred save go to flash first, so that
+  // if the apply below fails the files it falls back to have them
+  if (saveRequested) {
+    saveRequested = false;
+    saveData();
+  }
+  if (schedulesSaveRequested) {
+    schedulesSaveRequested = false;
+    saveSchedules();
+  }
+
+  recordingMode = false;
+  recordingRemoteId = -1;
+  recordingButtonId = -1;
+  clearRegistry();
+  // Schedules name buttons by id, so they are replaced along with the
+  // registry; a backup without schedules leaves none
+  clearSchedules();
+
+  file = LittleFS.open(RESTORE_TEMP_PATH, "r");
+  bool applied = file && readBackup(file, true, error);
+  if (file) file.close();
+  LittleFS.remove(RESTORE_TEMP_PATH);
+
+  // Validated but could not be applied (out of memory): go back to the data
+  // file, which has not been touched, and save nothing
+  if (!applied) {
+    clearRegistry();
+    loadData();
+    loadSchedules();
+    rebuildFingerprintIndex();
+
+    DynamicJsonDocument responseDoc(128);
+    responseDoc["error"] = error != nullptr ? error : "Failed to apply backup";
+    String response;
+    serializeJson(responseDoc, response);
+    server.send(500, "application/json", response);
+    return;
+  }
+
+  rebuildFingerprintIndex();
+  savesBlocked = false; // The registry is complete again
+  saveData(); // Save to flash
+  saveSchedules(); // Together, so a reset cannot pair the new registry with old schedules
+
+  server.send(200, "application/json", "{\"success\":true}");
+  Serial.println("Backup restaurado");
+}
+
 void handleGetCSS() {
   server.send(200, "text/css", CSS_CONTENT);
 }
@@ -536,6 +2947,19 @@ void handleNotFound() {
   server.send(404, "text/plain", "404: Not found");
 }
 
+void startMDNS() {
+  if (MDNS.begin(nodeName)) {
+    fleetService = MDNS.addService(nullptr, FLEET_SERVICE, "tcp", 80);
+    MDNS.addServiceTxt(fleetService, "room", FLEET_ROOM);
+    MDNS.setDynamicServiceTxtCallback(fleetService, updateFleetTxt);
+    mdnsStarted = true;
+    startFleetQuery();
+    Serial.print("mDNS iniciado: http://");
+    Serial.print(nodeName);
+    Serial.println(".local");
+  }
+}
+
 void setup() {
   Serial.begin(SERIAL_BAUD_RATE);
   delay(10);
@@ -556,59 +2980,110 @@ void setup() {
   }
 
   // Load saved data
+  unsigned long loadStartedAt = millis();
   loadData();
+  loadSchedules();
+  bootLoadMs = millis() - loadStartedAt;
 
   // Initialize IR
   irrecv.enableIRIn();
-  irsend.begin();
   Serial.println("IR inicializado");
   Serial.print("Receptor IR no pino: ");
   Serial.println(IR_RECEIVER_PIN);
-  Serial.print("Emissor IR no pino: ");
-  Serial.println(IR_LED_PIN);
+  for (int c = 0; c < IR_CHANNEL_COUNT; c++) {
+    irsend[c] = new IRsend(IR_CHANNEL_PIN_LIST[c]);
+    irsend[c]->begin();
+    Serial.print("Emissor IR no pino: ");
+    Serial.println(IR_CHANNEL_PIN_LIST[c]);
+  }
+
+  // Unique name, so several boards can share a network
+#ifdef NODE_NAME
+  strncpy(nodeName, NODE_NAME, sizeof(nodeName) - 1);
+#else
+  snprintf(nodeName, sizeof(nodeName), "ir-remote-%06x", ESP.getChipId());
+#endif
+  WiFi.hostname(nodeName);
 
   // Connect to WiFi
   WiFi.begin(WIFI_SSID, WIFI_PASSWD);
   Serial.print("Conectando ao WiFi");
 
-  while (WiFi.status() != WL_CONNECTED) {
+  // Bounded, so the serial interface and schedules work without a network;
+  // the WiFi stack keeps retrying in the background
+  unsigned long wifiStartedAt = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - wifiStartedAt < WIFI_CONNECT_TIMEOUT_MS) {
     delay(500);
     Serial.print(".");
   }
 
-  Serial.println("\nWiFi conectado!");
-  Serial.print("SSID: ");
-  Serial.println(WiFi.SSID());
-  Serial.print("IP: ");
-  Serial.println(WiFi.localIP());
-
-  // Initialize mDNS
-  if (MDNS.begin("ir-remote")) {
-    Serial.println("mDNS iniciado: http://ir-remote.local");
+  if (WiFi.status() == WL_CONNECTED) {
+    Serial.println("\nWiFi conectado!");
+    Serial.print("SSID: ");
+    Serial.println(WiFi.SSID());
+    Serial.print("IP: ");
+    Serial.println(WiFi.localIP());
+    startMDNS();
+  } else {
+    Serial.println("\nWiFi indisponivel, continuando sem rede");
   }
 
+  // Synced in the background; schedules start once the clock is set and keep
+  // running on the internal clock if the network goes away
+  configTime(TIMEZONE, NTP_SERVER_1, NTP_SERVER_2);
+
   // Configure server routes
   server.on("/", HTTP_GET, handleRoot);
   server.on("/style.css", HTTP_GET, handleGetCSS);
   server.on("/script.js", HTTP_GET, handleGetJS);
-  server.on("/api/remotes", HTTP_GET, handleGetRemotes);
-  server.on("/api/remote/add", HTTP_POST, handleAddRemote);
-  server.on("/api/remote/delete", HTTP_POST, handleDeleteRemote);
-  server.on("/api/remote/edit", HTTP_POST, handleEditRemote);
-  server.on("/api/button/add", HTTP_POST, handleAddButton);
-  server.on("/api/button/delete", HTTP_POST, handleDeleteButton);
-  server.on("/api/button/edit", HTTP_POST, handleEditButton);
-  server.on("/api/record/start", HTTP_POST, handleStartRecording);
-  server.on("/api/record/stop", HTTP_POST, handleStopRecording);
-  server.on("/api/signal/send", HTTP_POST, handleSendSignal);
+  onRoute("/api/signal/send", HTTP_POST, LANE_REALTIME, handleSendSignal);
+  onRoute("/api/signal/hold", HTTP_POST, LANE_REALTIME, handleHoldSignal);
+  onRoute("/api/signal/release", HTTP_POST, LANE_REALTIME, handleReleaseSignal);
+  onRoute("/api/macro/send", HTTP_POST, LANE_REALTIME, handleSendMacro);
+  onRoute("/api/record/stop", HTTP_POST, LANE_REALTIME, handleStopRecording);
+  onRoute("/api/listen", HTTP_GET, LANE_REALTIME, handleGetListenStatus);
+  onRoute("/api/listen/start", HTTP_POST, LANE_REALTIME, handleStartListening);
+  onRoute("/api/listen/stop", HTTP_POST, LANE_REALTIME, handleStopListening);
+  onRoute("/api/fleet/send", HTTP_POST, LANE_REALTIME, handleFleetSend);
+  onRoute("/api/fleet/local", HTTP_POST, LANE_REALTIME, handleFleetLocal);
+  onRoute("/api/fleet", HTTP_GET, LANE_MANAGEMENT, handleGetFleet);
+  onRoute("/api/fleet/discover", HTTP_POST, LANE_MANAGEMENT, handleFleetDiscover);
+  onRoute("/api/fleet/summary", HTTP_GET, LANE_MANAGEMENT, handleFleetSummary);
+  onRoute("/api/remotes", HTTP_GET, LANE_MANAGEMENT, handleGetRemotes);
+  onRoute("/api/remote/add", HTTP_POST, LANE_MANAGEMENT, handleAddRemote);
+  onRoute("/api/remote/delete", HTTP_POST, LANE_MANAGEMENT, handleDeleteRemote);
+  onRoute("/api/remote/edit", HTTP_POST, LANE_MANAGEMENT, handleEditRemote);
+  onRoute("/api/button/add", HTTP_POST, LANE_MANAGEMENT, handleAddButton);
+  onRoute("/api/button/delete", HTTP_POST, LANE_MANAGEMENT, handleDeleteButton);
+  onRoute("/api/button/edit", HTTP_POST, LANE_MANAGEMENT, handleEditButton);
+  onRoute("/api/record/start", HTTP_POST, LANE_MANAGEMENT, handleStartRecording);
+  onRoute("/api/library", HTTP_GET, LANE_MANAGEMENT, handleGetLibrary);
+  onRoute("/api/library/search", HTTP_GET, LANE_MANAGEMENT, handleLibrarySearch);
+  onRoute("/api/library/add", HTTP_POST, LANE_MANAGEMENT, handleLibraryAdd);
+  onRoute("/api/backup", HTTP_GET, LANE_MANAGEMENT, handleBackup);
+  onRoute("/api/schedules", HTTP_GET, LANE_MANAGEMENT, handleGetSchedules);
+  onRoute("/api/schedule/add", HTTP_POST, LANE_MANAGEMENT, handleAddSchedule);
+  onRoute("/api/schedule/delete", HTTP_POST, LANE_MANAGEMENT, handleDeleteSchedule);
+  server.on("/api/restore", HTTP_POST, []() {
+    handleInLane(LANE_MANAGEMENT, handleRestore);
+    // A shed restore never reaches handleRestore(), which removes the upload
+    if (LittleFS.exists(RESTORE_TEMP_PATH)) LittleFS.remove(RESTORE_TEMP_PATH);
+  }, handleRestoreUpload);
+  server.on("/api/metrics", HTTP_GET, handleGetMetrics);
   server.onNotFound(handleNotFound);
 
+  // Clients polling the API reuse their connection instead of paying a new
+  // TCP handshake on every request. The server still handles one client at
+  // a time and drops an idle kept-alive client as soon as another connects,
+  // so this only helps while a single client is active (tools/host
+  // throughput measures it).
+  server.keepAlive(true);
   server.begin();
   Serial.println("Servidor HTTP iniciado");
   Serial.println("Sistema pronto!");
 
-  // Add a sample remote control only if no data was loaded
-  if (remoteCount == 0) {
+  // Add a sample remote control only if there is no saved data
+  if (remoteCount == 0 && !savesBlocked) {
     Serial.println("Nenhum dado salvo encontrado. Criando controle de exemplo...");
     int remoteId = addRemote("Controle TV");
     addButton(remoteId, "Power");
@@ -621,7 +3096,16 @@ void setup() {
 
 void loop() {
   server.handleClient();
-  MDNS.update();
+  serviceSerialCommands();
+  serviceTransmitQueue();
+  serviceHold();
+
+  // mDNS starts late when the WiFi was not available at boot
+  if (mdnsStarted) {
+    MDNS.update();
+  } else if (WiFi.status() == WL_CONNECTED) {
+    startMDNS();
+  }
 
   // Recording mode
   if (recordingMode) {
@@ -637,6 +3121,7 @@ void loop() {
 
         // Save new signal
         remotes[recordingRemoteId].buttons[recordingButtonId].signal = signal;
+        rebuildFingerprintIndex();
 
         Serial.print("Sinal gravado para: ");
         Serial.print(remotes[recordingRemoteId].name);
@@ -644,7 +3129,7 @@ void loop() {
         Serial.println(remotes[recordingRemoteId].buttons[recordingButtonId].name);
 
         // Save to flash
-        saveData();
+        requestSave();
 
         // Stop recording automatically after capture
         recordingMode = false;
@@ -652,7 +3137,13 @@ void loop() {
         recordingButtonId = -1;
       }
     }
+  } else if (listenMode) {
+    listenForKnownSignal();
   }
 
-  delay(10);
+  serviceScheduler();
+  serviceDeferredSave();
+
+  // Short pause: only yields to the WiFi stack, requests are not held back
+  delay(1);
 }
@@ -10,9 +10,18 @@ const app = {
     remotes: [],
     currentRemote: null,
     currentButton: null,
-    recordingInterval: null
+    recordingInterval: null,
+    hold: null,
+    pressTimer: null,
+    suppressClick: false,
+    channels: 1
 };
 
+// A press becomes a hold after HOLD_DELAY_MS; the device keeps repeating a
+// held button only while it is renewed
+const HOLD_DELAY_MS = 400;
+const HOLD_RENEW_MS = 150;
+
 // Toast Notifications
 function showToast(type, title, message) {
     console.log(`[Toast ${type}] ${title}: ${message}`);
@@ -77,6 +86,7 @@ async function loadRemotes() {
     const data = await apiCall('/api/remotes', 'GET');
     if (data) {
         app.remotes = data.remotes;
+        app.channels = data.channels || 1;
         console.log('[Load] Controles carregados:', app.remotes.length);
         if (app.currentPage === 'home') renderHome();
     }
@@ -115,7 +125,15 @@ function renderHome() {
         });
     }
 
-    html += '</div>';
+    html += '</div>' +
+        '<div class="card">' +
+        '<div class="remote-item">' +
+        '<div class="remote-name">Backup</div>' +
+        '<div class="remote-actions">' +
+        '<button class="btn btn-secondary btn-small" onclick="downloadBackup()">Baixar</button>' +
+        '<button class="btn btn-secondary btn-small" onclick="document.getElementById(\'restore-file\').click()">Restaurar</button>' +
+        '<input type="file" id="restore-file" accept=".ndjson,.json" style="display: none;" onchange="restoreBackup(this)">' +
+        '</div></div></div>';
     appDiv.innerHTML = html;
 }
 
@@ -140,7 +158,10 @@ function renderViewRemote() {
         remote.buttons.forEach(function(button) {
             const hasSignal = button.hasSignal;
             html += '<div class="ir-button ' + (hasSignal ? '' : 'no-signal') + '" ' +
-                (hasSignal ? 'onclick="sendSignal(' + remote.id + ',' + button.id + ')"' : '') + '>' +
+                (hasSignal ? 'onclick="sendSignal(' + remote.id + ',' + button.id + ')" ' +
+                    'onpointerdown="pressButton(' + remote.id + ',' + button.id + ')" ' +
+                    'onpointerup="releaseButton(true)" onpointerleave="releaseButton(false)" ' +
+                    'onpointercancel="releaseButton(false)" oncontextmenu="return false"' : '') + '>' +
                 (hasSignal ? '<span class="badge"></span>' : '') +
                 '<div>' + escapeHtml(button.name) + '</div></div>';
         });
@@ -160,7 +181,22 @@ function renderEditRemote() {
         '<div class="header"><h1>Editar: ' + escapeHtml(remote.name) + '</h1></div>' +
         '<div class="card">' +
         '<button class="btn btn-primary btn-block" onclick="showAddButtonModal()">+ Novo Botao</button>' +
-        '</div><div class="card"><h3 style="margin-bottom: 16px;">Botoes</h3>';
+        '<button class="btn btn-secondary btn-block" style="margin-top: 12px;" onclick="showLibraryModal()">+ Da Biblioteca</button>' +
+        '</div>';
+
+    // Only boards with more than one emitter need to choose
+    if (app.channels > 1) {
+        let channelOptions = '';
+        for (let c = 0; c < app.channels; c++) {
+            channelOptions += '<option value="' + c + '"' + (remote.channel === c ? ' selected' : '') + '>Emissor ' + (c + 1) + '</option>';
+        }
+        html += '<div class="card"><div class="input-group" style="margin-bottom: 0;">' +
+            '<label>Emissor IR</label>' +
+            '<select class="input-field" onchange="saveRemoteChannel(' + remote.id + ', this.value)">' + channelOptions + '</select>' +
+            '</div></div>';
+    }
+
+    html += '<div class="card"><h3 style="margin-bottom: 16px;">Botoes</h3>';
 
     if (remote.buttons.length === 0) {
         html += '<div class="empty-state"><p>Nenhum botao cadastrado</p></div>';
@@ -234,12 +270,72 @@ async function deleteButton(remoteId, buttonId) {
 }
 
 async function sendSignal(remoteId, buttonId) {
+    // The click that ends a hold must not send again
+    if (app.suppressClick) {
+        app.suppressClick = false;
+        return;
+    }
+
     const result = await apiCall('/api/signal/send', 'POST', { remoteId: remoteId, buttonId: buttonId });
     if (result) {
         showToast('success', 'Enviado', 'Sinal IR transmitido');
     }
 }
 
+// A tap is a click and sends one frame. Only a press held in place turns into
+// a hold, so a swipe that starts on a button scrolls the page (the browser
+// cancels the pointer) and sends nothing.
+function pressButton(remoteId, buttonId) {
+    // A hold often ends without a click; its flag must not eat this tap
+    app.suppressClick = false;
+    releaseButton(false);
+    app.pressTimer = setTimeout(function() {
+        app.pressTimer = null;
+        startHold(remoteId, buttonId);
+    }, HOLD_DELAY_MS);
+}
+
+function releaseButton(isPointerUp) {
+    clearTimeout(app.pressTimer);
+    app.pressTimer = null;
+    if (app.hold) {
+        app.suppressClick = isPointerUp;
+        stopHold();
+    }
+}
+
+// The first frame is sent when the hold starts, repeats follow on the device
+// until release
+function startHold(remoteId, buttonId) {
+    stopHold();
+
+    const body = { remoteId: remoteId, buttonId: buttonId };
+    const hold = { request: apiCall('/api/signal/hold', 'POST', body), timer: null };
+    hold.timer = setInterval(function() {
+        fetch('/api/signal/hold', {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify({ remoteId: remoteId, buttonId: buttonId, renew: true })
+        }).catch(function() {});
+    }, HOLD_RENEW_MS);
+    app.hold = hold;
+}
+
+async function stopHold() {
+    const hold = app.hold;
+    if (!hold) return;
+
+    app.hold = null;
+    clearInterval(hold.timer);
+
+    // Released only once the hold has arrived, so the two cannot cross
+    const result = await hold.request;
+    if (result) {
+        await fetch('/api/signal/release', { method: 'POST' }).catch(function() {});
+        showToast('success', 'Enviado', 'Sinal IR transmitido');
+    }
+}
+
 async function startRecording(remoteId, buttonId) {
     const result = await apiCall('/api/record/start', 'POST', { remoteId: remoteId, buttonId: buttonId });
     if (result) {
@@ -260,6 +356,39 @@ async function stopRecording() {
     if (remote) navigateTo('edit', remote);
 }
 
+function downloadBackup() {
+    console.log('[Backup] Baixando backup');
+    window.location.href = '/api/backup';
+}
+
+async function restoreBackup(input) {
+    const file = input.files[0];
+    input.value = '';
+    if (!file) return;
+    if (!confirm('Todos os controles atuais serao substituidos. Continuar?')) return;
+
+    console.log('[Backup] Restaurando backup:', file.name, file.size);
+    try {
+        const response = await fetch('/api/restore', {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/x-ndjson' },
+            body: file
+        });
+        const data = await response.json();
+
+        if (response.status >= 400) {
+            showToast('error', 'Erro', data.error || 'Falha ao restaurar');
+            return;
+        }
+
+        showToast('success', 'Sucesso', 'Backup restaurado');
+        loadRemotes();
+    } catch (error) {
+        console.error('[Backup Error]', error);
+        showToast('error', 'Erro de Conexao', 'Nao foi possivel conectar ao servidor');
+    }
+}
+
 // Modals
 function showAddRemoteModal() {
     console.log('[Modal] Abrindo modal novo controle');
@@ -299,6 +428,91 @@ function showAddButtonModal() {
     }, 100);
 }
 
+async function showLibraryModal() {
+    console.log('[Modal] Abrindo modal da biblioteca');
+    const library = await apiCall('/api/library', 'GET');
+    if (!library) return;
+
+    let brandOptions = '<option value="">Todas</option>';
+    library.brands.forEach(function(brand) {
+        brandOptions += '<option value="' + escapeHtml(brand) + '">' + escapeHtml(brand) + '</option>';
+    });
+
+    let deviceOptions = '<option value="">Todos</option>';
+    library.devices.forEach(function(device) {
+        deviceOptions += '<option value="' + escapeHtml(device) + '">' + escapeHtml(device) + '</option>';
+    });
+
+    showModal(
+        '<div class="modal-header"><h2>Biblioteca de Codigos</h2></div>' +
+        '<div class="input-group">' +
+        '<label>Marca</label>' +
+        '<select id="library-brand" class="input-field" onchange="searchLibrary()">' + brandOptions + '</select>' +
+        '</div>' +
+        '<div class="input-group">' +
+        '<label>Aparelho</label>' +
+        '<select id="library-device" class="input-field" onchange="searchLibrary()">' + deviceOptions + '</select>' +
+        '</div>' +
+        '<div class="input-group">' +
+        '<label>Funcao</label>' +
+        '<input type="text" id="library-function" class="input-field" placeholder="Ex: Volume" oninput="searchLibrary()">' +
+        '</div>' +
+        '<div id="library-results"></div>' +
+        '<div class="modal-footer">' +
+        '<button class="btn btn-secondary" onclick="closeLibraryModal()">Fechar</button>' +
+        '</div>'
+    );
+    searchLibrary();
+}
+
+function closeLibraryModal() {
+    closeModal();
+    navigateTo('edit', app.currentRemote);
+}
+
+async function searchLibrary() {
+    const params = new URLSearchParams({
+        brand: document.getElementById('library-brand').value,
+        device: document.getElementById('library-device').value,
+        function: document.getElementById('library-function').value.trim()
+    });
+
+    const data = await apiCall('/api/library/search?' + params.toString(), 'GET');
+    const resultsDiv = document.getElementById('library-results');
+    if (!data || !resultsDiv) return;
+
+    if (data.results.length === 0) {
+        resultsDiv.innerHTML = '<div class="empty-state"><p>Nenhum codigo encontrado</p></div>';
+        return;
+    }
+
+    let html = '';
+    data.results.forEach(function(code) {
+        html += '<div class="remote-item" style="margin-bottom: 8px;">' +
+            '<div>' + escapeHtml(code.brand) + ' ' + escapeHtml(code.device) + ' - ' + escapeHtml(code.function) + '</div>' +
+            '<button class="btn btn-primary btn-small" onclick="addLibraryButton(' + code.id + ')">+</button>' +
+            '</div>';
+    });
+    if (data.total > data.results.length) {
+        html += '<p>Mostrando ' + data.results.length + ' de ' + data.total + ' codigos</p>';
+    }
+    resultsDiv.innerHTML = html;
+}
+
+async function addLibraryButton(codeId) {
+    const result = await apiCall('/api/library/add', 'POST', {
+        remoteId: app.currentRemote.id,
+        codeId: codeId
+    });
+
+    if (result) {
+        showToast('success', 'Sucesso', 'Botao adicionado da biblioteca');
+        await loadRemotes();
+        const remote = app.remotes.find(function(r) { return r.id === app.currentRemote.id; });
+        if (remote) app.currentRemote = remote;
+    }
+}
+
 function editButton(remoteId, buttonId) {
     const remote = app.remotes.find(function(r) { return r.id === remoteId; });
     const button = remote.buttons.find(function(b) { return b.id === buttonId; });
@@ -434,6 +648,20 @@ async function saveButtonEdit(remoteId, buttonId) {
     }
 }
 
+async function saveRemoteChannel(remoteId, channel) {
+    const result = await apiCall('/api/remote/edit', 'POST', {
+        remoteId: remoteId,
+        channel: parseInt(channel, 10)
+    });
+
+    if (result) {
+        showToast('success', 'Sucesso', 'Emissor atualizado');
+        await loadRemotes();
+        const remote = app.remotes.find(function(r) { return r.id === remoteId; });
+        if (remote) app.currentRemote = remote;
+    }
+}
+
 // Utility
 function escapeHtml(text) {
     const div = document.createElement('div');
@@ -203,6 +203,8 @@ body {
     font-weight: 600;
     position: relative;
     min-height: 80px;
+    user-select: none;
+    touch-action: manipulation;
     display: flex;
     flex-direction: column;
     justify-content: center;
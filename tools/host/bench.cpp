@@ -0,0 +1,120 @@
+// Boot benchmark: how long loading the data file takes and how much heap it
+// needs, for registries of different shapes up to the largest that fits.
+// Times are measured on the host, so only their ratios mean anything for
+// the board; the heap figures come from the simulated heap and carry over.
+//
+//   build/bench [--heap BYTES] [--runs N]
+#include <Arduino.h>
+
+#include "host.h"
+
+#include <algorithm>
+#include <chrono>
+
+// From the sketch
+bool loadData();
+void clearRegistry();
+extern int remoteCount;
+
+namespace {
+
+const char DATA_PATH[] = "/remotes.ndjson";
+
+struct Shape {
+  const char* name;
+  int remotes;
+  int buttonsPerRemote;
+  int timings; // 0 for library buttons
+};
+
+// The NEC registry is the largest that fits the default heap with room to
+// spare for requests
+const Shape SHAPES[] = {
+  {"sample", 1, 3, 0},
+  {"library, full", 10, 20, 0},
+  {"NEC captures, 100 buttons", 5, 20, 67},
+  {"NEC captures, full", 10, 20, 67},
+  {"AC captures, 20 buttons", 2, 10, 440},
+};
+
+// Writes a data file with this shape, in the format saveData() uses
+std::string buildDataFile(const Shape& shape) {
+  std::string file = "{\"type\":\"backup\",\"version\":1}\n";
+  for (int r = 0; r < shape.remotes; r++) {
+    file += "{\"type\":\"remote\",\"id\":" + std::to_string(r) + ",\"name\":\"Controle " + std::to_string(r) +
+            "\",\"channel\":0}\n";
+    for (int b = 0; b < shape.buttonsPerRemote; b++) {
+      file += "{\"type\":\"button\",\"remoteId\":" + std::to_string(r) + ",\"id\":" + std::to_string(b) +
+              ",\"name\":\"Botao " + std::to_string(b) + "\",\"hasSignal\":true,";
+      if (shape.timings == 0) {
+        file += "\"protocol\":\"NEC\",\"value\":\"20DF10EF\",\"bits\":32,\"brand\":\"LG\"}\n";
+        continue;
+      }
+      file += "\"length\":" + std::to_string(shape.timings) + "}\n[9000,4500";
+      for (int t = 2; t < shape.timings; t++) file += (t % 2 == 0 || (t * 7 + b) % 3) ? ",560" : ",1690";
+      file += "]\n";
+    }
+  }
+  file += "{\"type\":\"end\",\"remotes\":" + std::to_string(shape.remotes) +
+          ",\"buttons\":" + std::to_string(shape.remotes * shape.buttonsPerRemote) + "}\n";
+  return file;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t heap = 40960;
+  int runs = 50;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string flag = argv[i];
+    if (flag == "--heap") heap = strtoul(argv[i + 1], nullptr, 10);
+    else if (flag == "--runs") runs = max(1, atoi(argv[i + 1]));
+    else {
+      fprintf(stderr, "usage: %s [--heap BYTES] [--runs N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  // Boot once with the fullest registry on flash, as after a power cut
+  hostHeapInit(heap);
+  hostFlashWrite(DATA_PATH, buildDataFile(SHAPES[3]));
+  auto bootStartedAt = std::chrono::steady_clock::now();
+  {
+    HostSketchScope scope;
+    setup();
+  }
+  double bootUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - bootStartedAt).count();
+  HostHeapStats booted = hostHeapStats();
+  printf("setup() with \"%s\": %.0f us on the host, %d remotes, %u bytes free, largest block %u\n\n", SHAPES[3].name,
+         bootUs, remoteCount, booted.freeBytes, booted.maxBlock);
+
+  printf("shape,file_bytes,loaded,load_median_us,load_max_us,peak_heap_bytes,largest_alloc_bytes,free_after,max_block_after\n");
+  int failures = 0;
+  for (const Shape& shape : SHAPES) {
+    std::string file = buildDataFile(shape);
+    hostFlashWrite(DATA_PATH, file);
+
+    std::vector<double> times;
+    bool loaded = true;
+    HostHeapStats stats = {};
+    uint32_t peak = 0;
+    for (int run = 0; run < runs && loaded; run++) {
+      HostSketchScope scope;
+      clearRegistry();
+      uint32_t before = hostHeapStats().usedBytes;
+      hostHeapResetPeak();
+      auto startedAt = std::chrono::steady_clock::now();
+      loaded = loadData();
+      times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startedAt).count());
+      stats = hostHeapStats();
+      peak = stats.peakUsedBytes - before;
+    }
+    std::sort(times.begin(), times.end());
+    if (!loaded) failures++;
+
+    printf("%s,%zu,%s,%.0f,%.0f,%u,%u,%u,%u\n", shape.name, file.size(), loaded ? "yes" : "no", times[times.size() / 2],
+           times.back(), peak, stats.largestAllocation, stats.freeBytes, stats.maxBlock);
+    hostSerialTake();
+  }
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+// Fleet test on loopback: this process is node A; nodes B and C are the
+// same sketch forked into their own processes and served on 127.0.0.2 and
+// 127.0.0.3. Two more peers are announced over mDNS that cannot answer: one
+// address nobody listens on, and one that accepts connections but never
+// replies. The test checks fan-out results, timing, and that only the peer
+// that cannot be connected to is evicted.
+//
+//   build/fleet
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "host.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <map>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char nodeName[32];
+
+namespace {
+
+const uint16_t PORT = 18080;
+const unsigned long FAN_OUT_LIMIT_MS = 800 + 250 + 150; // FLEET_TIMEOUT_MS, one connect timeout and slack
+const std::vector<uint16_t> POWER_CAPTURE = {9000, 4500, 560, 1690, 560, 560, 560, 1690, 560, 560, 560};
+
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+  printf("%s %s\n", condition ? "ok  " : "FAIL", what);
+  if (!condition) failures++;
+}
+
+// Gives the sample remote's "Power" button a signal
+void recordPower() {
+  hostRequest(HOST_POST, "/api/record/start", "{\"remoteId\":0,\"buttonId\":0}");
+  hostInjectCapture(POWER_CAPTURE);
+  loop();
+}
+
+[[noreturn]] void runNode(const char* address) {
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+  hostSetLocalIP(address);
+  hostServeOn(address, PORT);
+  hostRealTime(true);
+  setup();
+  recordPower();
+  while (true) loop();
+}
+
+int connectTo(const char* address, uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in remote = {};
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons(port);
+  inet_pton(AF_INET, address, &remote.sin_addr);
+  if (connect(fd, (sockaddr*)&remote, sizeof(remote)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// A plain GET to another node; returns the body
+std::string get(const char* address, const char* path) {
+  int fd = connectTo(address, PORT);
+  if (fd < 0) return std::string();
+  std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: " + address + "\r\nConnection: close\r\n\r\n";
+  send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+  std::string reply;
+  char buffer[1024];
+  ssize_t n;
+  while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) reply.append(buffer, n);
+  close(fd);
+  size_t body = reply.find("\r\n\r\n");
+  return body != std::string::npos ? reply.substr(body + 4) : std::string();
+}
+
+int framesSentBy(const char* address) {
+  JsonDocument doc;
+  if (deserializeJson(doc, get(address, "/api/metrics").c_str())) return -1;
+  int frames = 0;
+  for (JsonObject channel : doc["channels"].as<JsonArray>()) frames += channel["frames"].as<int>();
+  return frames;
+}
+
+bool waitForNode(const char* address) {
+  for (int i = 0; i < 200; i++) {
+    int fd = connectTo(address, PORT);
+    if (fd >= 0) {
+      close(fd);
+      // The node records its signal right after setup; wait for it
+      if (framesSentBy(address) >= 0) return true;
+    }
+    usleep(20000);
+  }
+  return false;
+}
+
+struct Result {
+  bool found = false;
+  bool ok = false;
+  int status = 0;
+  bool skipped = false;
+};
+
+// Runs a fleet send and returns each node's result, keyed by node name
+std::map<std::string, Result> fleetSend(const char* body, unsigned long& elapsedMs) {
+  auto startedAt = std::chrono::steady_clock::now();
+  int status = hostRequest(HOST_POST, "/api/fleet/send", body);
+  elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startedAt).count();
+
+  std::map<std::string, Result> results;
+  JsonDocument doc;
+  if (status != 200 || deserializeJson(doc, hostResponse().c_str())) return results;
+  for (JsonObject resultObj : doc["results"].as<JsonArray>()) {
+    Result& result = results[resultObj["node"].as<const char*>()];
+    result.found = true;
+    result.ok = resultObj["ok"];
+    result.status = resultObj["status"] | 0;
+    result.skipped = resultObj["error"].is<const char*>() && !resultObj["status"].is<int>();
+  }
+  return results;
+}
+
+std::vector<std::string> listedPeers() {
+  hostRequest(HOST_GET, "/api/fleet");
+  JsonDocument doc;
+  std::vector<std::string> names;
+  if (deserializeJson(doc, hostResponse().c_str())) return names;
+  for (JsonObject peer : doc["peers"].as<JsonArray>()) names.push_back(peer["node"].as<const char*>());
+  return names;
+}
+
+bool listed(const char* name) {
+  std::vector<std::string> names = listedPeers();
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+} // namespace
+
+int main() {
+  pid_t nodes[2];
+  const char* addresses[2] = {"127.0.0.2", "127.0.0.3"};
+  for (int i = 0; i < 2; i++) {
+    nodes[i] = fork();
+    if (nodes[i] == 0) runNode(addresses[i]);
+  }
+
+  // Accepts connections into its backlog and never answers
+  int blackhole = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(PORT);
+  inet_pton(AF_INET, "127.0.0.5", &local.sin_addr);
+  if (bind(blackhole, (sockaddr*)&local, sizeof(local)) != 0 || listen(blackhole, 8) != 0) {
+    perror("fleet: blackhole listener");
+    return 2;
+  }
+
+  hostSerialEcho(false);
+  hostSetLocalIP("127.0.0.1");
+  hostRealTime(true);
+  setup();
+  recordPower();
+
+  expect(waitForNode("127.0.0.2") && waitForNode("127.0.0.3"), "nodes B and C are serving");
+
+  hostMdnsAnnounce("node-b", "127.0.0.2", PORT, "", 1, 3);
+  hostMdnsAnnounce("node-c", "127.0.0.3", PORT, "", 1, 3);
+  hostMdnsAnnounce("node-gone", "127.0.0.4", PORT, "", 1, 3);
+  hostMdnsAnnounce("node-stuck", "127.0.0.5", PORT, "", 1, 3);
+  hostMdnsAnnounce(nodeName, "127.0.0.1", 80, "", 1, 3); // Our own announcement
+  loop();
+
+  std::vector<std::string> peers = listedPeers();
+  expect(peers.size() == 4, "mDNS answers list four peers");
+  expect(!listed(nodeName), "own service is not listed as a peer");
+  expect(hostMdnsTxt("remotes") == "1" && hostMdnsTxt("buttons") == "3", "TXT record carries the registry size");
+
+  uint32_t localFramesBefore = hostIrFramesSent(4);
+  int framesB = framesSentBy("127.0.0.2");
+  int framesC = framesSentBy("127.0.0.3");
+  unsigned long elapsedMs;
+  std::map<std::string, Result> results = fleetSend("{\"button\":\"Power\"}", elapsedMs);
+  printf("     first fan-out took %lu ms\n", elapsedMs);
+
+  expect(results[nodeName].ok, "local node sent");
+  expect(hostIrFramesSent(4) > localFramesBefore, "local frame went out during the fan-out");
+  expect(results["node-b"].ok && results["node-c"].ok, "nodes B and C answered 200");
+  expect(results["node-gone"].found && !results["node-gone"].ok, "peer with no listener failed");
+  expect(results["node-stuck"].found && !results["node-stuck"].ok && results["node-stuck"].status == 0,
+         "peer that never replies timed out");
+  expect(elapsedMs < FAN_OUT_LIMIT_MS, "fan-out bounded by the reply timeout");
+
+  // B and C send from their own loop
+  usleep(300000);
+  expect(framesSentBy("127.0.0.2") == framesB + 1 && framesSentBy("127.0.0.3") == framesC + 1,
+         "nodes B and C each sent one frame");
+
+  results = fleetSend("{\"button\":\"Power\"}", elapsedMs);
+  printf("     second fan-out took %lu ms\n", elapsedMs);
+  expect(results["node-gone"].skipped, "peer that refused the connect is skipped on the next send");
+  expect(!results["node-stuck"].skipped && results["node-stuck"].status == 0, "busy peer is tried again");
+  expect(results["node-b"].ok && results["node-c"].ok, "nodes B and C still answer");
+
+  hostMdnsWithdraw("node-stuck");
+  loop();
+  results = fleetSend("{\"button\":\"Power\"}", elapsedMs);
+  printf("     third fan-out took %lu ms\n", elapsedMs);
+  expect(results["node-gone"].skipped && results["node-b"].ok, "evicted peer stays skipped");
+  expect(elapsedMs < 200, "fan-out without failed peers is quick");
+
+  hostMdnsAnnounce("node-b", "127.0.0.2", PORT, "sala", 1, 3);
+  loop();
+  results = fleetSend("{\"room\":\"sala\",\"button\":\"Power\"}", elapsedMs);
+  expect(results.size() == 1 && results["node-b"].ok, "room send reaches only the node in that room");
+
+  hostMdnsWithdraw("node-c");
+  loop();
+  expect(!listed("node-c") && listed("node-b"), "withdrawn node leaves the list");
+
+  hostRequest(HOST_POST, "/api/fleet/discover");
+  results = fleetSend("{\"button\":\"Power\"}", elapsedMs);
+  expect(results["node-gone"].found && !results["node-gone"].skipped, "discovery gives failed peers another try");
+
+  for (pid_t node : nodes) kill(node, SIGTERM);
+  for (pid_t node : nodes) waitpid(node, nullptr, 0);
+  close(blackhole);
+
+  printf("%s\n", failures == 0 ? "fleet: all checks passed" : "fleet: checks failed");
+  return failures == 0 ? 0 : 1;
+}
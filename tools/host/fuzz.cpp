@@ -0,0 +1,284 @@
+// Fuzz test for everything the sketch parses: backups sent to /api/restore,
+// the data file read at boot (current and legacy formats) and the JSON
+// bodies of the POST routes. Inputs are mutations of valid ones.
+//
+//   build/fuzz [--iterations N] [--seed S] [--heap BYTES]
+//
+// Checks, after every input: the status is one the API documents; a
+// rejected restore or a failed boot load leaves no partial registry; and
+// once the reference backup is restored again the heap holds exactly what
+// it did before, so nothing leaked.
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "host.h"
+
+#include <map>
+#include <random>
+
+// From the sketch
+bool loadData();
+void clearRegistry();
+extern bool savesBlocked;
+extern int remoteCount;
+
+namespace {
+
+const char DATA_PATH[] = "/remotes.ndjson";
+const char LEGACY_DATA_PATH[] = "/remotes.json";
+
+struct Options {
+  unsigned long iterations = 20000;
+  unsigned long seed = 1;
+  size_t heap = 40960;
+};
+
+std::mt19937 rng;
+unsigned long failures = 0;
+std::map<std::string, std::map<int, unsigned long>> outcomes; // Input kind -> status -> count
+
+int random(int low, int high) { return std::uniform_int_distribution<int>(low, high)(rng); }
+
+void check(bool condition, const char* what, unsigned long iteration) {
+  if (condition) return;
+  if (failures < 20) fprintf(stderr, "fuzz: iteration %lu: %s\n", iteration, what);
+  failures++;
+}
+
+void settle() {
+  for (int i = 0; i < 80; i++) {
+    {
+      HostSketchScope scope;
+      loop();
+    }
+    hostAdvanceMs(100);
+  }
+}
+
+// The remotes and the schedules, which a restore replaces together
+std::string registry() {
+  hostRequest(HOST_GET, "/api/remotes");
+  std::string remotes = hostResponse();
+  hostRequest(HOST_GET, "/api/schedules");
+  std::string schedules = hostResponse();
+  return remotes + schedules.substr(schedules.find("\"schedules\":")); // Without the clock
+}
+
+// Longer inputs get more mutations; the tokens are ones parsers tend to
+// get wrong
+std::string mutate(std::string input) {
+  static const char* tokens[] = {
+    "-1", "0", "65535", "65536", "4294967296", "99999999999999999999", "1e308", "-0.5", "null", "true",
+    "\"\"", "\"\\u0000\"", "\"\\ud800\"", "[", "]", "{", "}", ",", ":", "\n", "\"remote\"", "\"button\"",
+    "\"end\"", "\"schedule\"", "[[[[[[[[[[[[[[[[", "{\"a\":{\"b\":{\"c\":{\"d\":1}}}}",
+  };
+  int count = random(1, 4);
+  for (int n = 0; n < count; n++) {
+    size_t at = input.empty() ? 0 : random(0, input.size() - 1);
+    size_t span = min((size_t)random(1, 32), input.size() - at);
+    switch (random(0, 6)) {
+      case 0:
+        if (!input.empty()) input[at] = (char)random(0, 255);
+        break;
+      case 1:
+        input.erase(at, span);
+        break;
+      case 2:
+        input.insert(at, input.substr(at, span));
+        break;
+      case 3:
+        input.insert(at, tokens[random(0, sizeof(tokens) / sizeof(tokens[0]) - 1)]);
+        break;
+      case 4:
+        input.insert(at, std::string(random(1, 600), 'A'));
+        break;
+      case 5:
+        input.resize(at);
+        break;
+      case 6: {
+        // Swap two lines, so records arrive out of order
+        size_t first = input.find('\n', at);
+        size_t second = first == std::string::npos ? first : input.find('\n', first + 1);
+        if (second == std::string::npos) break;
+        std::string line = input.substr(first + 1, second - first);
+        input.erase(first + 1, line.size());
+        input.insert(0, line);
+        break;
+      }
+    }
+  }
+  return input;
+}
+
+// Valid bodies for every JSON route, mutated before use
+const struct {
+  const char* path;
+  const char* body;
+} ROUTES[] = {
+  {"/api/signal/send", "{\"remoteId\":0,\"buttonId\":0}"},
+  {"/api/signal/hold", "{\"remoteId\":0,\"buttonId\":0,\"renew\":false}"},
+  {"/api/macro/send", "{\"steps\":[{\"remoteId\":0,\"buttonId\":0,\"delayMs\":100},{\"remoteId\":1,\"buttonId\":1}]}"},
+  {"/api/fleet/send", "{\"room\":\"*\",\"remote\":\"Controle TV\",\"button\":\"Power\"}"},
+  {"/api/fleet/local", "{\"remote\":\"Controle TV\",\"button\":\"Power\"}"},
+  {"/api/remote/add", "{\"name\":\"Novo\"}"},
+  {"/api/remote/delete", "{\"remoteId\":1}"},
+  {"/api/remote/edit", "{\"remoteId\":0,\"name\":\"TV\",\"channel\":0}"},
+  {"/api/button/add", "{\"remoteId\":0,\"name\":\"Mute\"}"},
+  {"/api/button/delete", "{\"remoteId\":0,\"buttonId\":2}"},
+  {"/api/button/edit", "{\"remoteId\":0,\"buttonId\":1,\"name\":\"Vol\"}"},
+  {"/api/record/start", "{\"remoteId\":0,\"buttonId\":1}"},
+  {"/api/library/add", "{\"remoteId\":1,\"codeId\":3,\"name\":\"Power\"}"},
+  {"/api/schedule/add", "{\"type\":\"daily\",\"time\":\"07:30\",\"steps\":[{\"remoteId\":0,\"buttonId\":0}]}"},
+  {"/api/schedule/delete", "{\"scheduleId\":0}"},
+};
+
+// A small file in the format used before the record-per-line one
+const char LEGACY_DATA[] =
+  "{\"remotes\":[{\"id\":0,\"name\":\"TV\",\"buttons\":["
+  "{\"id\":0,\"name\":\"Power\",\"hasSignal\":true,\"length\":5,\"data\":[9000,4500,560,1690,560]},"
+  "{\"id\":1,\"name\":\"Mute\",\"hasSignal\":true,\"protocol\":\"NEC\",\"value\":\"20DF10EF\",\"bits\":32},"
+  "{\"id\":2,\"name\":\"Input\",\"hasSignal\":false}]},"
+  "{\"id\":1,\"name\":\"Som\",\"buttons\":[{\"id\":0,\"name\":\"Vol\",\"hasSignal\":true,\"length\":3,\"data\":[560,560,560]}]}]}";
+
+// Two remotes with recorded and library buttons, and a schedule using both
+void buildReference() {
+  hostRequest(HOST_POST, "/api/remote/add", "{\"name\":\"Som\"}");
+  hostRequest(HOST_POST, "/api/button/add", "{\"remoteId\":1,\"name\":\"Vol\"}");
+  hostRequest(HOST_POST, "/api/library/add", "{\"remoteId\":1,\"codeId\":0}");
+  for (int button = 0; button < 2; button++) {
+    hostRequest(HOST_POST, "/api/record/start", "{\"remoteId\":0,\"buttonId\":" + std::to_string(button) + "}");
+    std::vector<uint16_t> capture = {9000, 4500};
+    for (int i = 0; i < 32 + button * 40; i++) {
+      capture.push_back(560);
+      capture.push_back(random(0, 1) ? 1690 : 560);
+    }
+    hostInjectCapture(capture);
+    settle();
+  }
+  hostRequest(HOST_POST, "/api/schedule/add",
+              "{\"type\":\"weekly\",\"time\":\"07:30\",\"days\":62,"
+              "\"steps\":[{\"remoteId\":0,\"buttonId\":1,\"delayMs\":500},{\"remoteId\":1,\"buttonId\":0}]}");
+  settle();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string flag = argv[i];
+    unsigned long value = strtoul(argv[i + 1], nullptr, 10);
+    if (flag == "--iterations") options.iterations = value;
+    else if (flag == "--seed") options.seed = value;
+    else if (flag == "--heap") options.heap = value;
+    else return false;
+  }
+  return argc % 2 == 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr, "usage: %s [--iterations N] [--seed S] [--heap BYTES]\n", argv[0]);
+    return 2;
+  }
+  rng.seed(options.seed);
+
+  hostHeapInit(options.heap);
+  {
+    HostSketchScope scope;
+    setup();
+  }
+  buildReference();
+
+  hostRequest(HOST_GET, "/api/backup");
+  const std::string referenceBackup = hostResponse();
+  const std::string referenceRegistry = registry();
+  settle();
+  const HostHeapStats reference = hostHeapStats();
+  uint32_t worstPeak = 0;
+
+  for (unsigned long iteration = 1; iteration <= options.iterations; iteration++) {
+    const char* kind;
+    hostHeapResetPeak();
+    int choice = random(0, 9);
+
+    if (choice <= 2) {
+      kind = "restore";
+      std::string before = registry();
+      int status = hostRequest(HOST_POST, "/api/restore", mutate(referenceBackup));
+      outcomes[kind][status]++;
+      check(status == 200 || status == 400 || status == 500, "unexpected restore status", iteration);
+      if (status != 200) check(registry() == before, "rejected restore changed the registry", iteration);
+    } else if (choice <= 4) {
+      kind = choice == 3 ? "boot load" : "boot load (legacy)";
+      LittleFS.remove(DATA_PATH);
+      LittleFS.remove(LEGACY_DATA_PATH);
+      if (choice == 3) {
+        hostFlashWrite(DATA_PATH, mutate(referenceBackup));
+      } else {
+        hostFlashWrite(LEGACY_DATA_PATH, mutate(LEGACY_DATA));
+      }
+
+      bool loaded;
+      {
+        HostSketchScope scope;
+        clearRegistry();
+        savesBlocked = false;
+        loaded = loadData();
+      }
+      outcomes[kind][loaded ? 1 : 0]++;
+      if (!loaded) {
+        check(remoteCount == 0 && savesBlocked, "failed boot load left a partial registry", iteration);
+        std::string stored;
+        check(choice != 3 || hostFlashRead(DATA_PATH, stored), "failed boot load removed the data file", iteration);
+      }
+    } else {
+      const auto& route = ROUTES[random(0, sizeof(ROUTES) / sizeof(ROUTES[0]) - 1)];
+      std::string body;
+      int shape = random(0, 9);
+      if (shape == 0) {
+        kind = "oversized body";
+        body = std::string("{\"name\":\"") + std::string(random(1030, 8000), 'x') + "\"}";
+      } else if (shape == 1) {
+        kind = "random body";
+        body.resize(random(0, 64));
+        for (char& c : body) c = (char)random(0, 255);
+      } else {
+        kind = "mutated body";
+        body = mutate(route.body);
+      }
+      hostInjectCapture({9000, 4500, 560, 1690, 560}); // For record/start
+      int status = hostRequest(HOST_POST, route.path, body);
+      outcomes[kind][status]++;
+      check(status == 200 || status == 400 || status == 404 || status == 413 || status == 500 || status == 503,
+            "unexpected request status", iteration);
+      if (shape == 0) check(status == 413, "oversized body not refused", iteration);
+    }
+
+    worstPeak = max(worstPeak, hostHeapStats().peakUsedBytes - reference.usedBytes);
+
+    // Back to the reference state; the heap must match it exactly
+    settle();
+    check(hostRequest(HOST_POST, "/api/restore", referenceBackup) == 200, "reference restore failed", iteration);
+    check(registry() == referenceRegistry, "reference restore gave a different registry", iteration);
+    hostRequest(HOST_POST, "/api/listen/stop");
+    hostRequest(HOST_POST, "/api/record/stop");
+    hostRequest(HOST_POST, "/api/signal/release");
+    settle();
+    hostSerialTake();
+    HostHeapStats stats = hostHeapStats();
+    check(stats.usedBytes == reference.usedBytes && stats.allocations == reference.allocations,
+          "heap did not return to the reference state", iteration);
+  }
+
+  printf("input,result,count\n");
+  for (const auto& kind : outcomes) {
+    for (const auto& result : kind.second) {
+      printf("%s,%d,%lu\n", kind.first.c_str(), result.first, result.second);
+    }
+  }
+  HostHeapStats end = hostHeapStats();
+  fprintf(stderr, "fuzz: %lu inputs, %lu failures; worst peak above reference %u bytes; %u failed allocations; "
+          "fragmentation at end %u%%\n", options.iterations, failures, worstPeak, hostHeapFailures(), end.fragmentation);
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,1076 @@
+// Host implementations of the stubbed ESP8266 core and libraries
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266mDNS.h>
+#include <IRrecv.h>
+#include <IRsend.h>
+#include <IRutils.h>
+#include <LittleFS.h>
+
+#include "host.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <deque>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <new>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// Simulated heap
+// Blocks are multiples of 8 bytes with an 8-byte header holding the size of
+// the block and of the one before it; free neighbours are merged on release.
+namespace {
+
+const size_t HEAP_HEADER = 8;
+const size_t HEAP_MIN_BLOCK = 16;
+
+struct BlockHeader {
+  uint32_t size; // Includes the header; bit 0 set when in use
+  uint32_t previousSize;
+};
+
+uint8_t* arena = nullptr;
+size_t arenaSize = 0;
+bool heapActive = false;
+uint32_t heapFailures = 0;
+uint32_t heapUsed = 0;
+uint32_t heapPeak = 0;
+uint32_t heapLargest = 0;
+uint32_t heapAllocations = 0;
+
+BlockHeader* blockAt(size_t offset) { return (BlockHeader*)(arena + offset); }
+size_t blockSize(const BlockHeader* block) { return block->size & ~1u; }
+bool blockUsed(const BlockHeader* block) { return block->size & 1u; }
+
+bool inArena(const void* p) {
+  return arena != nullptr && (const uint8_t*)p >= arena && (const uint8_t*)p < arena + arenaSize;
+}
+
+void* arenaAllocate(size_t size) {
+  size_t needed = (size + HEAP_HEADER + 7) & ~(size_t)7;
+  if (needed < HEAP_MIN_BLOCK) needed = HEAP_MIN_BLOCK;
+
+  // Best fit, as umm_malloc is configured in the ESP8266 core
+  size_t best = arenaSize;
+  size_t bestSize = SIZE_MAX;
+  for (size_t offset = 0; offset < arenaSize; offset += blockSize(blockAt(offset))) {
+    BlockHeader* block = blockAt(offset);
+    if (!blockUsed(block) && blockSize(block) >= needed && blockSize(block) < bestSize) {
+      best = offset;
+      bestSize = blockSize(block);
+    }
+  }
+  if (best == arenaSize) return nullptr;
+
+  BlockHeader* block = blockAt(best);
+  if (bestSize - needed >= HEAP_MIN_BLOCK) {
+    BlockHeader* rest = blockAt(best + needed);
+    rest->size = bestSize - needed;
+    rest->previousSize = needed;
+    size_t after = best + bestSize;
+    if (after < arenaSize) blockAt(after)->previousSize = rest->size;
+    block->size = needed;
+  }
+  block->size |= 1u;
+
+  heapUsed += blockSize(block);
+  heapPeak = max(heapPeak, heapUsed);
+  heapLargest = max(heapLargest, (uint32_t)size);
+  heapAllocations++;
+  return (uint8_t*)block + HEAP_HEADER;
+}
+
+void arenaRelease(void* p) {
+  size_t offset = (uint8_t*)p - arena - HEAP_HEADER;
+  BlockHeader* block = blockAt(offset);
+  if (!blockUsed(block)) {
+    fprintf(stderr, "heap: double free at offset %zu\n", offset);
+    abort();
+  }
+  block->size &= ~1u;
+  heapUsed -= blockSize(block);
+  heapAllocations--;
+
+  size_t next = offset + blockSize(block);
+  if (next < arenaSize && !blockUsed(blockAt(next))) {
+    block->size += blockSize(blockAt(next));
+  }
+  if (offset > 0) {
+    size_t previous = offset - block->previousSize;
+    if (!blockUsed(blockAt(previous))) {
+      blockAt(previous)->size += blockSize(block);
+      block = blockAt(previous);
+      offset = previous;
+    }
+  }
+  next = offset + blockSize(block);
+  if (next < arenaSize) blockAt(next)->previousSize = blockSize(block);
+}
+
+void* allocate(size_t size, bool nothrow) {
+  if (!heapActive || arena == nullptr) {
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == nullptr && !nothrow) throw std::bad_alloc();
+    return p;
+  }
+
+  void* p = arenaAllocate(size);
+  if (p == nullptr) {
+    if (nothrow) {
+      heapFailures++;
+      return nullptr;
+    }
+    // On the board a failed new aborts and the chip resets
+    HostHeapStats stats = hostHeapStats();
+    fprintf(stderr, "heap: out of memory allocating %zu bytes (free %u, largest block %u, fragmentation %u%%)\n",
+            size, stats.freeBytes, stats.maxBlock, stats.fragmentation);
+    exit(3);
+  }
+  return p;
+}
+
+void release(void* p) {
+  if (p == nullptr) return;
+  if (inArena(p)) {
+    arenaRelease(p);
+  } else {
+    free(p);
+  }
+}
+
+} // namespace
+
+void* operator new(size_t size) { return allocate(size, false); }
+void* operator new[](size_t size) { return allocate(size, false); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, true); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, true); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+
+void hostHeapInit(size_t bytes) {
+  arenaSize = bytes & ~(size_t)7;
+  arena = (uint8_t*)aligned_alloc(16, arenaSize);
+  blockAt(0)->size = arenaSize;
+  blockAt(0)->previousSize = 0;
+  heapUsed = 0;
+  heapPeak = 0;
+  heapAllocations = 0;
+}
+
+void hostHeapSetActive(bool active) { heapActive = active; }
+bool hostHeapActive() { return heapActive; }
+uint32_t hostHeapFailures() { return heapFailures; }
+void hostHeapResetPeak() {
+  heapPeak = heapUsed;
+  heapLargest = 0;
+}
+void* hostHeapAllocate(size_t size) { return allocate(size, true); }
+void hostHeapRelease(void* p) { release(p); }
+
+HostHeapStats hostHeapStats() {
+  HostHeapStats stats = {};
+  double squares = 0;
+  for (size_t offset = 0; arena != nullptr && offset < arenaSize; offset += blockSize(blockAt(offset))) {
+    const BlockHeader* block = blockAt(offset);
+    if (blockUsed(block)) continue;
+    stats.freeBytes += blockSize(block);
+    stats.maxBlock = max(stats.maxBlock, (uint32_t)(blockSize(block) - HEAP_HEADER));
+    squares += (double)blockSize(block) * blockSize(block);
+  }
+  stats.fragmentation = stats.freeBytes > 0 ? (uint8_t)(100 - sqrt(squares) * 100 / stats.freeBytes) : 0;
+  stats.usedBytes = heapUsed;
+  stats.peakUsedBytes = heapPeak;
+  stats.largestAllocation = heapLargest;
+  stats.allocations = heapAllocations;
+  return stats;
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() { return hostHeapStats().freeBytes; }
+uint32_t EspClass::getMaxFreeBlockSize() { return hostHeapStats().maxBlock; }
+uint8_t EspClass::getHeapFragmentation() { return hostHeapStats().fragmentation; }
+
+// Clock
+namespace {
+
+const auto clockStart = std::chrono::steady_clock::now();
+unsigned long long offsetUs = 0;
+bool realTime = false;
+
+unsigned long long elapsedUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+} // namespace
+
+unsigned long millis() { return (unsigned long)((elapsedUs() + offsetUs) / 1000); }
+unsigned long micros() { return (unsigned long)(elapsedUs() + offsetUs); }
+
+void delay(unsigned long ms) {
+  if (realTime) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  } else {
+    offsetUs += ms * 1000ULL;
+  }
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (realTime) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  } else {
+    offsetUs += us;
+  }
+}
+void yield() {}
+void configTime(const char*, const char*, const char*, const char*) {}
+void hostAdvanceMs(unsigned long ms) { offsetUs += ms * 1000ULL; }
+void hostRealTime(bool enabled) { realTime = enabled; }
+
+// Serial
+HardwareSerial Serial;
+
+namespace {
+
+bool serialEcho = false;
+std::deque<char> serialInput;
+std::string serialOutput;
+const int UART_FIFO_SIZE = 128;
+const unsigned long UART_BYTE_US = 87; // 10 bits at 115200 baud
+unsigned long uartEmptyAt = 0; // micros() when the FIFO will have drained
+
+} // namespace
+
+int HardwareSerial::available() { return serialInput.size(); }
+
+int HardwareSerial::read() {
+  if (serialInput.empty()) return -1;
+  HostHeapPause pause;
+  char c = serialInput.front();
+  serialInput.pop_front();
+  return (uint8_t)c;
+}
+
+int HardwareSerial::peek() { return serialInput.empty() ? -1 : (uint8_t)serialInput.front(); }
+
+// Writes never block here, they only fill the modelled FIFO
+size_t HardwareSerial::write(uint8_t c) {
+  HostHeapPause pause;
+  if ((long)(micros() - uartEmptyAt) > 0) uartEmptyAt = micros();
+  uartEmptyAt += UART_BYTE_US;
+  if (serialEcho) fputc(c, stdout);
+  if (serialOutput.size() < 1 << 20) serialOutput += (char)c;
+  return 1;
+}
+
+int HardwareSerial::availableForWrite() {
+  long queued = ((long)(uartEmptyAt - micros()) + (long)UART_BYTE_US - 1) / (long)UART_BYTE_US;
+  return UART_FIFO_SIZE - constrain(queued, 0L, (long)UART_FIFO_SIZE);
+}
+
+void hostSerialEcho(bool echo) { serialEcho = echo; }
+
+void hostSerialInput(const std::string& text) {
+  HostHeapPause pause;
+  serialInput.insert(serialInput.end(), text.begin(), text.end());
+}
+
+std::string hostSerialTake() {
+  HostHeapPause pause;
+  std::string output;
+  output.swap(serialOutput);
+  return output;
+}
+
+// WiFi
+WiFiClass WiFi;
+
+namespace {
+
+bool wifiConnected = true;
+IPAddress localAddress(127, 0, 0, 1);
+char wifiHostname[33] = "host";
+
+} // namespace
+
+wl_status_t WiFiClass::status() { return wifiConnected ? WL_CONNECTED : WL_DISCONNECTED; }
+IPAddress WiFiClass::localIP() { return localAddress; }
+String WiFiClass::hostname() { return String(wifiHostname); }
+
+bool WiFiClass::hostname(const char* name) {
+  strncpy(wifiHostname, name, sizeof(wifiHostname) - 1);
+  return true;
+}
+
+void hostWiFiConnected(bool connected) { wifiConnected = connected; }
+void hostSetLocalIP(const char* address) { localAddress.fromString(address); }
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  stop();
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return 0;
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl((uint32_t)ip[0] << 24 | (uint32_t)ip[1] << 16 | (uint32_t)ip[2] << 8 | ip[3]);
+
+  if (::connect(fd, (sockaddr*)&address, sizeof(address)) == 0) return 1;
+  if (errno == EINPROGRESS) {
+    pollfd waiting = {fd, POLLOUT, 0};
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&waiting, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+      return 1;
+    }
+    // The core waits out the whole timeout before giving up
+    delay(0);
+  }
+  stop();
+  return 0;
+}
+
+uint8_t WiFiClient::connected() {
+  if (fd < 0) return 0;
+  char c;
+  ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+void WiFiClient::stop() {
+  if (fd >= 0) close(fd);
+  fd = -1;
+}
+
+int WiFiClient::available() {
+  if (fd < 0) return 0;
+  int n = 0;
+  ioctl(fd, FIONREAD, &n);
+  return n;
+}
+
+int WiFiClient::read() {
+  unsigned char c;
+  return fd >= 0 && recv(fd, &c, 1, MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+int WiFiClient::peek() {
+  unsigned char c;
+  return fd >= 0 && recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  if (fd < 0) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+    if (n > 0) {
+      sent += n;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      pollfd waiting = {fd, POLLOUT, 0};
+      if (poll(&waiting, 1, timeoutMs) != 1) break;
+    } else {
+      break;
+    }
+  }
+  return sent;
+}
+
+// mDNS
+struct HostMdnsNode {
+  std::string name;
+  std::string serviceDomain;
+  std::string hostDomain;
+  IPAddress ip;
+  uint16_t port = 0;
+  std::map<std::string, std::string> txt;
+  unsigned version = 0;
+  bool withdrawn = false;
+};
+
+MDNSResponder MDNS;
+
+namespace {
+
+struct MdnsQuery {
+  MDNSResponder::MDNSServiceQueryCallbackFunc callback;
+  std::map<const HostMdnsNode*, unsigned> delivered; // Version each node was last reported at
+};
+
+// Nodes are kept after being withdrawn, since answers point at them
+std::vector<std::unique_ptr<HostMdnsNode>> mdnsNodes;
+std::vector<std::unique_ptr<MdnsQuery>> mdnsQueries;
+std::map<std::string, std::string> ownTxt;
+MDNSResponder::MDNSDynamicServiceTxtCallbackFunc ownDynamicTxt;
+const char ownService[] = "service";
+uint32_t announcements = 0;
+
+HostMdnsNode* findMdnsNode(const char* name) {
+  for (auto& node : mdnsNodes) {
+    if (node->name == name) return node.get();
+  }
+  return nullptr;
+}
+
+} // namespace
+
+const char* MDNSResponder::MDNSServiceInfo::serviceDomain() { return node->serviceDomain.c_str(); }
+const char* MDNSResponder::MDNSServiceInfo::hostDomain() { return node->hostDomain.c_str(); }
+bool MDNSResponder::MDNSServiceInfo::hostPortAvailable() { return node->port != 0; }
+uint16_t MDNSResponder::MDNSServiceInfo::hostPort() { return node->port; }
+bool MDNSResponder::MDNSServiceInfo::IP4AddressAvailable() { return node->ip.isSet(); }
+
+std::vector<IPAddress> MDNSResponder::MDNSServiceInfo::IP4Adresses() {
+  return node->ip.isSet() ? std::vector<IPAddress>{node->ip} : std::vector<IPAddress>();
+}
+
+const char* MDNSResponder::MDNSServiceInfo::value(const char* key) {
+  auto found = node->txt.find(key);
+  return found != node->txt.end() ? found->second.c_str() : nullptr;
+}
+
+bool MDNSResponder::begin(const char*) { return true; }
+
+// Reports what changed since each query last looked, one callback per part
+// of the answer as LEAmDNS does
+bool MDNSResponder::update() {
+  struct Event {
+    MDNSResponder::MDNSServiceQueryCallbackFunc callback;
+    const HostMdnsNode* node;
+    AnswerType type;
+    bool isSet;
+  };
+  std::vector<Event> events;
+  {
+    HostHeapPause pause;
+    for (auto& query : mdnsQueries) {
+      for (auto& node : mdnsNodes) {
+        auto delivered = query->delivered.find(node.get());
+        bool known = delivered != query->delivered.end();
+        if (node->withdrawn) {
+          if (!known) continue;
+          events.push_back({query->callback, node.get(), AnswerType::ServiceDomain, false});
+          query->delivered.erase(delivered);
+          continue;
+        }
+        if (known && delivered->second == node->version) continue;
+        if (!known) events.push_back({query->callback, node.get(), AnswerType::ServiceDomain, true});
+        events.push_back({query->callback, node.get(), AnswerType::HostDomainAndPort, true});
+        events.push_back({query->callback, node.get(), AnswerType::IP4Address, true});
+        events.push_back({query->callback, node.get(), AnswerType::Txt, true});
+        query->delivered[node.get()] = node->version;
+      }
+    }
+  }
+
+  for (const Event& event : events) {
+    event.callback(MDNSServiceInfo(event.node), event.type, event.isSet);
+  }
+  HostHeapPause pause;
+  events.clear();
+  events.shrink_to_fit();
+  return true;
+}
+
+bool MDNSResponder::announce() {
+  if (ownDynamicTxt) ownDynamicTxt(ownService);
+  announcements++;
+  return true;
+}
+
+MDNSResponder::hMDNSService MDNSResponder::addService(const char*, const char*, const char*, uint16_t) {
+  return ownService;
+}
+
+MDNSResponder::hMDNSTxt MDNSResponder::addServiceTxt(hMDNSService service, const char* key, const char* value) {
+  HostHeapPause pause;
+  ownTxt[key] = value;
+  return service;
+}
+
+MDNSResponder::hMDNSTxt MDNSResponder::addDynamicServiceTxt(hMDNSService service, const char* key, uint32_t value) {
+  HostHeapPause pause;
+  ownTxt[key] = std::to_string(value);
+  return service;
+}
+
+bool MDNSResponder::setDynamicServiceTxtCallback(hMDNSService, MDNSDynamicServiceTxtCallbackFunc callback) {
+  HostHeapPause pause;
+  ownDynamicTxt = callback;
+  return true;
+}
+
+MDNSResponder::hMDNSServiceQuery MDNSResponder::installServiceQuery(const char*, const char*,
+                                                                    MDNSServiceQueryCallbackFunc callback) {
+  HostHeapPause pause;
+  mdnsQueries.emplace_back(new MdnsQuery{callback, {}});
+  return mdnsQueries.back().get();
+}
+
+bool MDNSResponder::removeServiceQuery(hMDNSServiceQuery query) {
+  HostHeapPause pause;
+  for (auto it = mdnsQueries.begin(); it != mdnsQueries.end(); ++it) {
+    if (it->get() != query) continue;
+    mdnsQueries.erase(it);
+    return true;
+  }
+  return false;
+}
+
+void hostMdnsAnnounce(const char* name, const char* address, uint16_t port, const char* room, int remotes, int buttons) {
+  HostHeapPause pause;
+  HostMdnsNode* node = findMdnsNode(name);
+  if (node == nullptr) {
+    mdnsNodes.emplace_back(new HostMdnsNode());
+    node = mdnsNodes.back().get();
+    node->name = name;
+    node->serviceDomain = std::string(name) + "._irremote._tcp.local";
+    node->hostDomain = std::string(name) + ".local";
+  }
+  node->ip.fromString(address);
+  node->port = port;
+  node->txt["room"] = room;
+  node->txt["remotes"] = std::to_string(remotes);
+  node->txt["buttons"] = std::to_string(buttons);
+  node->withdrawn = false;
+  node->version++;
+}
+
+void hostMdnsWithdraw(const char* name) {
+  HostMdnsNode* node = findMdnsNode(name);
+  if (node != nullptr) node->withdrawn = true;
+}
+
+std::string hostMdnsTxt(const char* key) {
+  if (ownDynamicTxt) ownDynamicTxt(ownService);
+  HostHeapPause pause;
+  auto found = ownTxt.find(key);
+  return found != ownTxt.end() ? found->second : std::string();
+}
+
+uint32_t hostMdnsAnnouncements() { return announcements; }
+
+// Flash
+struct HostFileImpl {
+  std::string path;
+  std::shared_ptr<std::vector<uint8_t>> data;
+  size_t position = 0;
+  bool writable = false;
+  bool open = true;
+  uint8_t cache[256]; // LittleFS keeps a cache buffer per open file
+};
+
+FS LittleFS;
+
+namespace {
+
+std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> flashFiles;
+size_t flashCapacity = 1 << 20;
+uint64_t flashWritten = 0;
+
+size_t flashUsed() {
+  size_t used = 0;
+  for (const auto& file : flashFiles) used += file.second->size();
+  return used;
+}
+
+} // namespace
+
+bool FS::format() {
+  HostHeapPause pause;
+  flashFiles.clear();
+  return true;
+}
+
+bool FS::exists(const char* path) { return flashFiles.count(path) > 0; }
+
+File FS::open(const char* path, const char* mode) {
+  std::shared_ptr<std::vector<uint8_t>> data;
+  {
+    HostHeapPause pause;
+    auto found = flashFiles.find(path);
+    if (mode[0] == 'r') {
+      if (found == flashFiles.end()) return File();
+      data = found->second;
+    } else if (mode[0] == 'w' || found == flashFiles.end()) {
+      data = std::make_shared<std::vector<uint8_t>>();
+      flashFiles[path] = data;
+    } else {
+      data = found->second;
+    }
+  }
+
+  // Allocated from the sketch's heap, as the real file handle is
+  std::shared_ptr<HostFileImpl> impl = std::make_shared<HostFileImpl>();
+  HostHeapPause pause;
+  impl->path = path;
+  impl->data = data;
+  impl->writable = mode[0] != 'r';
+  impl->position = mode[0] == 'a' ? data->size() : 0;
+  return File(impl);
+}
+
+bool FS::remove(const char* path) {
+  HostHeapPause pause;
+  return flashFiles.erase(path) > 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+  HostHeapPause pause;
+  auto found = flashFiles.find(from);
+  if (found == flashFiles.end()) return false;
+  flashFiles[to] = found->second;
+  flashFiles.erase(from);
+  return true;
+}
+
+void File::close() {
+  HostHeapPause pause;
+  impl.reset();
+}
+
+size_t File::size() const { return impl != nullptr ? impl->data->size() : 0; }
+size_t File::position() const { return impl != nullptr ? impl->position : 0; }
+
+bool File::seek(uint32_t position) {
+  if (impl == nullptr || position > impl->data->size()) return false;
+  impl->position = position;
+  return true;
+}
+
+int File::available() { return impl != nullptr ? impl->data->size() - impl->position : 0; }
+
+int File::read() {
+  if (impl == nullptr || impl->position >= impl->data->size()) return -1;
+  return (*impl->data)[impl->position++];
+}
+
+int File::peek() {
+  if (impl == nullptr || impl->position >= impl->data->size()) return -1;
+  return (*impl->data)[impl->position];
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  if (impl == nullptr || !impl->writable) return 0;
+  HostHeapPause pause;
+  size_t room = flashCapacity > flashUsed() ? flashCapacity - flashUsed() : 0;
+  size = min(size, room); // A full flash takes what fits
+  std::vector<uint8_t>& data = *impl->data;
+  if (impl->position + size > data.size()) data.resize(impl->position + size);
+  memcpy(data.data() + impl->position, buffer, size);
+  impl->position += size;
+  flashWritten += size;
+  return size;
+}
+
+uint64_t hostFlashBytesWritten() { return flashWritten; }
+void hostFlashSetCapacity(size_t bytes) { flashCapacity = bytes; }
+
+bool hostFlashRead(const char* path, std::string& content) {
+  HostHeapPause pause;
+  auto found = flashFiles.find(path);
+  if (found == flashFiles.end()) return false;
+  content.assign(found->second->begin(), found->second->end());
+  return true;
+}
+
+void hostFlashWrite(const char* path, const std::string& content) {
+  HostHeapPause pause;
+  flashFiles[path] = std::make_shared<std::vector<uint8_t>>(content.begin(), content.end());
+}
+
+// Web server
+namespace {
+
+ESP8266WebServer* hostServer = nullptr;
+String emptyArg;
+
+std::string urlDecode(const std::string& text) {
+  std::string decoded;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '+') {
+      decoded += ' ';
+    } else if (text[i] == '%' && i + 2 < text.size()) {
+      decoded += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+      i += 2;
+    } else {
+      decoded += text[i];
+    }
+  }
+  return decoded;
+}
+
+// Waits at most a second for each piece, like the core's client timeout
+bool receiveAll(int fd, char* data, size_t size) {
+  while (size > 0) {
+    pollfd waiting = {fd, POLLIN, 0};
+    if (poll(&waiting, 1, 1000) != 1) return false;
+    ssize_t n = recv(fd, data, size, 0);
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+} // namespace
+
+ESP8266WebServer::ESP8266WebServer(int) { hostServer = this; }
+
+void ESP8266WebServer::on(const char* uri, HTTPMethod method, THandlerFunction fn) { on(uri, method, fn, nullptr); }
+
+void ESP8266WebServer::on(const char* uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+  // Handlers are allocated on the heap and kept for good, as in the core
+  Route* route = new Route{uri, method, fn, ufn, nullptr};
+  Route** last = &routes;
+  while (*last != nullptr) last = &(*last)->next;
+  *last = route;
+}
+
+bool ESP8266WebServer::hasArg(const char* name) const {
+  for (int i = 0; i < argCount; i++) {
+    if (*argNames[i] == name) return true;
+  }
+  return false;
+}
+
+const String& ESP8266WebServer::arg(const char* name) const {
+  for (int i = 0; i < argCount; i++) {
+    if (*argNames[i] == name) return *argValues[i];
+  }
+  return emptyArg;
+}
+
+void ESP8266WebServer::send(int code, const char*, const char* content) {
+  HostHeapPause pause;
+  responseStatus = code;
+  responseBody = content;
+}
+
+void ESP8266WebServer::sendContent(const char* content, size_t size) {
+  HostHeapPause pause;
+  responseBody.append(content, size);
+}
+
+void ESP8266WebServer::clearArgs() {
+  for (int i = 0; i < argCount; i++) {
+    delete argNames[i];
+    delete argValues[i];
+  }
+  argCount = 0;
+}
+
+// Runs one request the way ESP8266WebServer::_parseRequest and
+// _handleRequest do; arguments and the raw buffer come from the sketch heap
+int ESP8266WebServer::dispatch(HTTPMethod method, const std::string& target, const std::string& body) {
+  std::string path;
+  std::vector<std::pair<std::string, std::string>> query;
+  {
+    HostHeapPause pause;
+    size_t mark = target.find('?');
+    path = target.substr(0, mark);
+    if (mark != std::string::npos) {
+      std::string rest = target.substr(mark + 1);
+      size_t start = 0;
+      while (start <= rest.size()) {
+        size_t end = rest.find('&', start);
+        if (end == std::string::npos) end = rest.size();
+        std::string pair = rest.substr(start, end - start);
+        size_t equals = pair.find('=');
+        if (!pair.empty()) {
+          query.emplace_back(urlDecode(pair.substr(0, equals)),
+                             equals == std::string::npos ? std::string() : urlDecode(pair.substr(equals + 1)));
+        }
+        start = end + 1;
+      }
+    }
+    responseStatus = 0;
+    responseBody.clear();
+  }
+
+  Route* route = routes;
+  while (route != nullptr && !(path == route->uri && (route->method == HTTP_ANY || route->method == method))) {
+    route = route->next;
+  }
+
+  HostSketchScope scope;
+  for (const auto& pair : query) {
+    if (argCount == HTTP_MAX_ARGS) break;
+    argNames[argCount] = new String(pair.first.c_str());
+    argValues[argCount] = new String(pair.second.c_str());
+    argCount++;
+  }
+  contentLength = body.size();
+
+  if (route != nullptr && route->ufn && method != HTTP_GET) {
+    currentRaw = new HTTPRaw();
+    currentRaw->status = RAW_START;
+    currentRaw->totalSize = 0;
+    currentRaw->currentSize = 0;
+    route->ufn();
+    currentRaw->status = RAW_WRITE;
+    while (currentRaw->totalSize < body.size()) {
+      size_t size = min(body.size() - currentRaw->totalSize, (size_t)HTTP_RAW_BUFLEN);
+      memcpy(currentRaw->buf, body.data() + currentRaw->totalSize, size);
+      currentRaw->currentSize = size;
+      currentRaw->totalSize += size;
+      route->ufn();
+    }
+    currentRaw->status = RAW_END;
+    route->ufn();
+  } else if (!body.empty() && argCount < HTTP_MAX_ARGS) {
+    argNames[argCount] = new String("plain");
+    argValues[argCount] = new String(body);
+    argCount++;
+  }
+
+  if (route != nullptr) {
+    route->fn();
+  } else if (notFound) {
+    notFound();
+  } else {
+    send(404, "text/plain", "");
+  }
+
+  delete currentRaw;
+  currentRaw = nullptr;
+  clearArgs();
+  return responseStatus;
+}
+
+void ESP8266WebServer::serveOn(const char* address, uint16_t port) {
+  listenAddress = address;
+  listenPort = port;
+}
+
+void ESP8266WebServer::begin() {
+  if (listenPort == 0) return;
+  HostHeapPause pause;
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(listenPort);
+  inet_pton(AF_INET, listenAddress.c_str(), &local.sin_addr);
+  if (bind(listenFd, (sockaddr*)&local, sizeof(local)) != 0 || listen(listenFd, 8) != 0) {
+    perror("web server");
+    exit(2);
+  }
+  fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+}
+
+// One step of the core's client state machine: take a new client when
+// none is held, serve a request when one has arrived, and otherwise decide
+// whether to keep waiting on the current client
+void ESP8266WebServer::handleClient() {
+  if (listenFd < 0) return;
+  if (clientFd < 0) {
+    clientFd = accept(listenFd, nullptr, nullptr);
+    if (clientFd < 0) return;
+    clientState = CLIENT_WAIT_READ;
+    clientStateAt = millis();
+  }
+
+  bool keepClient = false;
+  pollfd waiting = {clientFd, POLLIN, 0};
+  char peek;
+  if (poll(&waiting, 1, 0) == 1) {
+    // Readable with nothing to read means the client has closed
+    if (recv(clientFd, &peek, 1, MSG_PEEK) == 1 && serveOne(clientFd)) {
+      clientState = CLIENT_WAIT_CLOSE;
+      clientStateAt = millis();
+      keepClient = true;
+    }
+  } else if (clientState == CLIENT_WAIT_READ) {
+    keepClient = millis() - clientStateAt <= (hasPendingClient() ? HTTP_MAX_DATA_AVAILABLE_WAIT : HTTP_MAX_DATA_WAIT);
+  } else {
+    keepClient = !hasPendingClient() && millis() - clientStateAt <= HTTP_MAX_CLOSE_WAIT;
+  }
+
+  if (!keepClient) {
+    close(clientFd);
+    clientFd = -1;
+    clientState = CLIENT_NONE;
+  }
+}
+
+bool ESP8266WebServer::hasPendingClient() const {
+  pollfd waiting = {listenFd, POLLIN, 0};
+  return poll(&waiting, 1, 0) == 1;
+}
+
+// Reads one request (headers and Content-Length body) and writes the reply;
+// returns whether the connection stays open for another request
+bool ESP8266WebServer::serveOne(int fd) {
+  std::string request;
+  std::string body;
+  HTTPMethod method = HTTP_GET;
+  std::string target;
+  bool keepAlive = keepAliveEnabled;
+  {
+    // Read as the core does, the header up to its blank line and then
+    // exactly the body, so a pipelined request stays in the socket
+    HostHeapPause pause;
+    char c;
+    while (request.size() < 4 || request.compare(request.size() - 4, 4, "\r\n\r\n") != 0) {
+      if (!receiveAll(fd, &c, 1)) return false;
+      request += c;
+    }
+    size_t at = request.find("Content-Length:");
+    body.resize(at != std::string::npos ? strtoul(request.c_str() + at + 15, nullptr, 10) : 0);
+    if (!body.empty() && !receiveAll(fd, &body[0], body.size())) return false;
+
+    method = request.compare(0, 5, "POST ") == 0 ? HTTP_POST : HTTP_GET;
+    size_t start = request.find(' ') + 1;
+    target = request.substr(start, request.find(' ', start) - start);
+    if (request.find("Connection: close") != std::string::npos || request.find(" HTTP/1.0\r\n") != std::string::npos) {
+      keepAlive = false;
+    }
+  }
+
+  int status = dispatch(method, target, body);
+
+  HostHeapPause pause;
+  char header[160];
+  snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+           status, status == 200 ? "OK" : "Error", responseBody.size(), keepAlive ? "keep-alive" : "close");
+  std::string reply = std::string(header) + responseBody;
+  return ::send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) == (ssize_t)reply.size() && keepAlive;
+}
+
+int hostRequest(int method, const char* target, const std::string& body) {
+  return hostServer->dispatch((HTTPMethod)method, target, body);
+}
+
+const std::string& hostResponse() { return hostServer->response(); }
+
+void hostServeOn(const char* address, uint16_t port) { hostServer->serveOn(address, port); }
+
+// IR
+namespace {
+
+std::vector<uint16_t> pendingCapture;
+std::map<int, uint32_t> framesSent;
+
+} // namespace
+
+void hostInjectCapture(const std::vector<uint16_t>& timings) {
+  HostHeapPause pause;
+  pendingCapture = timings;
+}
+
+uint32_t hostIrFramesSent(int pin) { return framesSent[pin]; }
+
+IRrecv::IRrecv(uint16_t, uint16_t bufferSize, uint8_t, bool) : bufferSize(bufferSize) {}
+
+// The capture buffer is taken from the heap, as the library does
+void IRrecv::enableIRIn() {
+  if (rawbuf == nullptr) rawbuf = new uint16_t[bufferSize];
+}
+
+bool IRrecv::decode(decode_results* results) {
+  if (rawbuf == nullptr || pendingCapture.empty()) return false;
+
+  uint16_t length = min(pendingCapture.size(), (size_t)bufferSize - 1);
+  rawbuf[0] = 0;
+  for (uint16_t i = 0; i < length; i++) {
+    rawbuf[i + 1] = pendingCapture[i] / kRawTick;
+  }
+  results->decode_type = UNKNOWN;
+  results->value = 0;
+  results->bits = 0;
+  results->rawbuf = rawbuf;
+  results->rawlen = length + 1;
+  results->overflow = false;
+  results->repeat = false;
+
+  HostHeapPause pause;
+  pendingCapture.clear();
+  return true;
+}
+
+void IRrecv::resume() {}
+
+uint16_t getCorrectedRawLength(const decode_results* results) { return results->rawlen - 1; }
+
+uint16_t* resultToRawArray(const decode_results* results) {
+  uint16_t length = getCorrectedRawLength(results);
+  uint16_t* data = new uint16_t[length];
+  for (uint16_t i = 0; i < length; i++) {
+    data[i] = results->rawbuf[i + 1] * kRawTick;
+  }
+  return data;
+}
+
+namespace {
+
+const struct {
+  decode_type_t protocol;
+  const char* name;
+} protocolNames[] = {
+  {RC5, "RC5"}, {RC6, "RC6"}, {NEC, "NEC"}, {SONY, "SONY"}, {PANASONIC, "PANASONIC"},
+  {JVC, "JVC"}, {SAMSUNG, "SAMSUNG"}, {LG, "LG"}, {COOLIX, "COOLIX"},
+  {NEC_LIKE, "NEC (non-strict)"}, {LG2, "LG2"},
+};
+
+} // namespace
+
+String typeToString(decode_type_t protocol, bool isRepeat) {
+  for (const auto& entry : protocolNames) {
+    if (entry.protocol == protocol) return String(entry.name) + (isRepeat ? " (Repeat)" : "");
+  }
+  return String("UNKNOWN");
+}
+
+decode_type_t strToDecodeType(const char* name) {
+  for (const auto& entry : protocolNames) {
+    if (strcasecmp(entry.name, name) == 0) return entry.protocol;
+  }
+  return UNKNOWN;
+}
+
+String uint64ToString(uint64_t value, uint8_t base) {
+  char buffer[72];
+  char* p = buffer + sizeof(buffer) - 1;
+  *p = '\0';
+  do {
+    int digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  return String(p);
+}
+
+void IRsend::sendRaw(const uint16_t* buffer, uint16_t length, uint16_t) {
+  unsigned long frameUs = 0;
+  for (uint16_t i = 0; i < length; i++) frameUs += buffer[i];
+  HostHeapPause pause;
+  framesSent[pin]++;
+  delayMicroseconds(frameUs);
+}
+
+// Library protocols take roughly as long on air as an NEC frame
+bool IRsend::send(decode_type_t, uint64_t, uint16_t, uint16_t) {
+  HostHeapPause pause;
+  framesSent[pin]++;
+  delayMicroseconds(68000);
+  return true;
+}
@@ -0,0 +1,94 @@
+// Host-side harness API. The stubs in stubs/ stand in for the ESP8266 core
+// and libraries; this header is what the harness programs use to drive the
+// sketch: a simulated heap, a clock, injected HTTP requests and IR captures,
+// and an in-memory flash file system.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// The sketch
+void setup();
+void loop();
+
+// Simulated ESP8266 heap. While active, every C++ allocation goes to a fixed
+// arena managed like umm_malloc (8-byte blocks, best fit), so the sketch's
+// free heap, largest block and fragmentation can be watched over time.
+// Allocations made while it is not active come from the host and cost
+// nothing.
+struct HostHeapStats {
+  uint32_t freeBytes;
+  uint32_t maxBlock; // Largest allocation that would succeed
+  uint8_t fragmentation; // Same formula as ESP.getHeapFragmentation()
+  uint32_t usedBytes;
+  uint32_t peakUsedBytes; // Since hostHeapResetPeak()
+  uint32_t largestAllocation; // Since hostHeapResetPeak()
+  uint32_t allocations; // Live allocations
+};
+
+void hostHeapInit(size_t arenaBytes);
+void hostHeapSetActive(bool active);
+bool hostHeapActive();
+HostHeapStats hostHeapStats();
+void hostHeapResetPeak();
+uint32_t hostHeapFailures(); // Failed nothrow allocations
+void* hostHeapAllocate(size_t size);
+void hostHeapRelease(void* p);
+
+// Runs sketch code with the simulated heap active
+struct HostSketchScope {
+  bool previous;
+  HostSketchScope() : previous(hostHeapActive()) { hostHeapSetActive(true); }
+  ~HostSketchScope() { hostHeapSetActive(previous); }
+};
+
+// Keeps harness bookkeeping out of the simulated heap
+struct HostHeapPause {
+  bool previous;
+  HostHeapPause() : previous(hostHeapActive()) { hostHeapSetActive(false); }
+  ~HostHeapPause() { hostHeapSetActive(previous); }
+};
+
+// Clock: real time plus a simulated offset. delay() only moves the offset
+// unless real time is turned on, in which case it sleeps.
+void hostAdvanceMs(unsigned long ms);
+void hostRealTime(bool enabled);
+
+// Serial: output is kept (and echoed if asked) until taken
+void hostSerialEcho(bool echo);
+void hostSerialInput(const std::string& text);
+std::string hostSerialTake();
+
+// Flash
+uint64_t hostFlashBytesWritten();
+void hostFlashSetCapacity(size_t bytes);
+bool hostFlashRead(const char* path, std::string& content);
+void hostFlashWrite(const char* path, const std::string& content);
+
+// HTTP: runs the handler for method and target (path plus optional query),
+// as the web server would, and returns the status; the response body is in
+// hostResponse(). Methods are the HTTPMethod values, e.g. HOST_POST.
+enum { HOST_GET = 1, HOST_POST = 3 };
+int hostRequest(int method, const char* target, const std::string& body = std::string());
+const std::string& hostResponse();
+// Serves the sketch's web server on a real socket from begin() on
+void hostServeOn(const char* address, uint16_t port);
+
+// IR: the next irrecv.decode() returns this raw capture (timings in us)
+void hostInjectCapture(const std::vector<uint16_t>& timings);
+uint32_t hostIrFramesSent(int pin);
+
+// Network
+void hostWiFiConnected(bool connected);
+void hostSetLocalIP(const char* address);
+
+// mDNS: other nodes offering the sketch's service, as its service queries
+// see them. Announcing a name again updates it; changes reach the sketch in
+// its next MDNS.update().
+void hostMdnsAnnounce(const char* name, const char* address, uint16_t port, const char* room, int remotes, int buttons);
+void hostMdnsWithdraw(const char* name);
+// A TXT value this node advertises, dynamic ones included
+std::string hostMdnsTxt(const char* key);
+uint32_t hostMdnsAnnouncements();
@@ -0,0 +1,4 @@
+// The sketch itself, compiled against the stubs
+#include <Arduino.h>
+
+#include "../../engcomp_tcc.ino"
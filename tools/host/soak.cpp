@@ -0,0 +1,272 @@
+// Soak test: drives the sketch with a long random mix of registry edits,
+// recordings, sends, deferred saves and backup/restore round trips, and
+// prints how the simulated heap and the flash wear develop over time.
+//
+//   build/soak [--ops N] [--seed S] [--heap BYTES] [--report-every N] [--min-block BYTES]
+//
+// Output is CSV, one row per report. The run fails (exit 1) when an
+// allocation fails, the largest free block drops below --min-block, or the
+// registry no longer matches what was asked of it.
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "host.h"
+
+#include <chrono>
+#include <random>
+
+namespace {
+
+struct Options {
+  unsigned long ops = 100000;
+  unsigned long seed = 1;
+  size_t heap = 40960; // About what is left once WiFi is up
+  unsigned long reportEvery = 5000;
+  uint32_t minBlock = 4096;
+};
+
+std::mt19937 rng;
+double handlerTotalUs = 0;
+double handlerMaxUs = 0;
+unsigned long handlerCount = 0;
+unsigned long failures = 0;
+
+int random(int low, int high) { return std::uniform_int_distribution<int>(low, high)(rng); }
+
+void runLoop(int iterations, unsigned long stepMs) {
+  for (int i = 0; i < iterations; i++) {
+    {
+      HostSketchScope scope;
+      loop();
+    }
+    hostAdvanceMs(stepMs);
+  }
+}
+
+// Deferred saves and queued frames are done once the loop has run a few
+// seconds without new requests
+void settle() { runLoop(80, 100); }
+
+int request(int method, const char* target, const std::string& body = std::string()) {
+  auto startedAt = std::chrono::steady_clock::now();
+  int status = hostRequest(method, target, body);
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startedAt).count();
+
+  // Management requests are turned away while frames are queued
+  if (status == 503) {
+    settle();
+    return request(method, target, body);
+  }
+
+  handlerTotalUs += us;
+  handlerMaxUs = max(handlerMaxUs, us);
+  handlerCount++;
+  return status;
+}
+
+std::string json(std::initializer_list<std::pair<const char*, int>> fields, const char* name = nullptr) {
+  std::string body = "{";
+  for (const auto& field : fields) {
+    if (body.size() > 1) body += ",";
+    body += "\"" + std::string(field.first) + "\":" + std::to_string(field.second);
+  }
+  if (name != nullptr) body += std::string(body.size() > 1 ? "," : "") + "\"name\":\"" + name + "\"";
+  return body + "}";
+}
+
+// What GET /api/remotes reports, kept as plain ids
+struct Registry {
+  std::vector<int> remotes;
+  std::vector<std::vector<int>> buttons;
+  std::vector<std::vector<bool>> hasSignal;
+  size_t signals = 0;
+};
+
+Registry readRegistry() {
+  request(HOST_GET, "/api/remotes");
+  HostHeapPause pause;
+  Registry registry;
+  JsonDocument doc;
+  if (deserializeJson(doc, hostResponse().c_str())) {
+    fprintf(stderr, "soak: unreadable remote list\n");
+    exit(1);
+  }
+  for (JsonObject remote : doc["remotes"].as<JsonArray>()) {
+    registry.remotes.push_back(remote["id"]);
+    registry.buttons.emplace_back();
+    registry.hasSignal.emplace_back();
+    for (JsonObject button : remote["buttons"].as<JsonArray>()) {
+      registry.buttons.back().push_back(button["id"]);
+      registry.hasSignal.back().push_back(button["hasSignal"]);
+      if (button["hasSignal"]) registry.signals++;
+    }
+  }
+  return registry;
+}
+
+// An NEC-style frame with a random payload and, now and then, a longer raw
+// tail, so recorded signals come in a spread of sizes
+std::vector<uint16_t> randomCapture() {
+  std::vector<uint16_t> timings = {9000, 4500};
+  int bits = random(0, 3) == 0 ? random(40, 200) : 32;
+  for (int i = 0; i < bits; i++) {
+    timings.push_back(560);
+    timings.push_back(random(0, 1) ? 1690 : 560);
+  }
+  timings.push_back(560);
+  return timings;
+}
+
+void check(bool condition, const char* what, unsigned long op) {
+  if (condition) return;
+  fprintf(stderr, "soak: op %lu: %s\n", op, what);
+  failures++;
+}
+
+void runOperation(unsigned long op) {
+  Registry registry = readRegistry();
+  int remoteIndex = registry.remotes.empty() ? -1 : random(0, registry.remotes.size() - 1);
+  int remoteId = remoteIndex >= 0 ? registry.remotes[remoteIndex] : -1;
+  const std::vector<int>* buttons = remoteIndex >= 0 ? &registry.buttons[remoteIndex] : nullptr;
+  int buttonIndex = buttons != nullptr && !buttons->empty() ? random(0, buttons->size() - 1) : -1;
+  int buttonId = buttonIndex >= 0 ? (*buttons)[buttonIndex] : -1;
+  char name[24];
+  snprintf(name, sizeof(name), "Op %lu", op);
+
+  switch (random(0, 11)) {
+    case 0: {
+      int status = request(HOST_POST, "/api/remote/add", json({}, name));
+      // Ids of deleted remotes are only reclaimed when the registry is
+      // reloaded, so a full table is compacted through a backup
+      if (status != 200) {
+        request(HOST_GET, "/api/backup");
+        std::string backup = hostResponse();
+        check(request(HOST_POST, "/api/restore", backup) == 200, "restore to compact the registry failed", op);
+      }
+      break;
+    }
+    case 1:
+    case 2:
+      if (remoteId >= 0) request(HOST_POST, "/api/button/add", json({{"remoteId", remoteId}}, name));
+      break;
+    case 3:
+    case 4:
+      if (buttonId >= 0) {
+        check(request(HOST_POST, "/api/record/start", json({{"remoteId", remoteId}, {"buttonId", buttonId}})) == 200,
+              "record start refused", op);
+        hostInjectCapture(randomCapture());
+        runLoop(1, 10);
+      }
+      break;
+    case 5:
+      if (remoteId >= 0) request(HOST_POST, "/api/library/add", json({{"remoteId", remoteId}, {"codeId", random(0, 40)}}));
+      break;
+    case 6:
+      if (buttonId >= 0) {
+        check(request(HOST_POST, "/api/button/delete", json({{"remoteId", remoteId}, {"buttonId", buttonId}})) == 200,
+              "button delete refused", op);
+      }
+      break;
+    case 7:
+      if (remoteId >= 0 && random(0, 3) == 0) {
+        check(request(HOST_POST, "/api/remote/delete", json({{"remoteId", remoteId}})) == 200, "remote delete refused", op);
+      }
+      break;
+    case 8:
+      if (buttonId >= 0) request(HOST_POST, "/api/button/edit", json({{"remoteId", remoteId}, {"buttonId", buttonId}}, name));
+      break;
+    case 9:
+      if (buttonId >= 0 && registry.hasSignal[remoteIndex][buttonIndex]) {
+        request(HOST_POST, "/api/signal/send", json({{"remoteId", remoteId}, {"buttonId", buttonId}}));
+      }
+      break;
+    case 10:
+      request(HOST_GET, "/api/metrics");
+      break;
+    case 11:
+      if (random(0, 9) == 0) {
+        request(HOST_GET, "/api/backup");
+        std::string backup = hostResponse();
+        check(request(HOST_POST, "/api/restore", backup) == 200, "restore of a fresh backup failed", op);
+        Registry restored = readRegistry();
+        check(restored.signals == registry.signals, "restore lost recorded signals", op);
+      }
+      break;
+  }
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string flag = argv[i];
+    unsigned long value = strtoul(argv[i + 1], nullptr, 10);
+    if (flag == "--ops") options.ops = value;
+    else if (flag == "--seed") options.seed = value;
+    else if (flag == "--heap") options.heap = value;
+    else if (flag == "--report-every") options.reportEvery = max(value, 1UL);
+    else if (flag == "--min-block") options.minBlock = value;
+    else return false;
+  }
+  return argc % 2 == 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr, "usage: %s [--ops N] [--seed S] [--heap BYTES] [--report-every N] [--min-block BYTES]\n", argv[0]);
+    return 2;
+  }
+  rng.seed(options.seed);
+
+  hostHeapInit(options.heap);
+  {
+    HostSketchScope scope;
+    setup();
+  }
+  settle();
+  hostSerialTake();
+
+  HostHeapStats boot = hostHeapStats();
+  printf("ops,sim_hours,free,max_block,fragmentation,live_allocs,peak_used,flash_kb,handler_avg_us,handler_max_us,remotes,signals\n");
+
+  uint32_t lowestBlock = boot.maxBlock;
+  auto report = [&](unsigned long op) {
+    settle();
+    Registry registry = readRegistry();
+    HostHeapStats stats = hostHeapStats();
+    lowestBlock = min(lowestBlock, stats.maxBlock);
+    printf("%lu,%.1f,%u,%u,%u,%u,%u,%llu,%.0f,%.0f,%zu,%zu\n", op, millis() / 3600000.0, stats.freeBytes,
+           stats.maxBlock, stats.fragmentation, stats.allocations, stats.peakUsedBytes,
+           (unsigned long long)(hostFlashBytesWritten() / 1024), handlerCount > 0 ? handlerTotalUs / handlerCount : 0.0,
+           handlerMaxUs, registry.remotes.size(), registry.signals);
+    fflush(stdout);
+    hostHeapResetPeak();
+    handlerTotalUs = 0;
+    handlerMaxUs = 0;
+    handlerCount = 0;
+    hostSerialTake();
+  };
+
+  report(0);
+  for (unsigned long op = 1; op <= options.ops; op++) {
+    runOperation(op);
+    // Users are not that fast: let the loop run between requests
+    runLoop(random(1, 5), random(100, 3000));
+    if (op % options.reportEvery == 0) report(op);
+  }
+  if (options.ops % options.reportEvery != 0) report(options.ops);
+
+  HostHeapStats end = hostHeapStats();
+  fprintf(stderr, "soak: boot max block %u, lowest %u, end %u; fragmentation %u%% -> %u%%\n", boot.maxBlock,
+          lowestBlock, end.maxBlock, boot.fragmentation, end.fragmentation);
+  if (hostHeapFailures() > 0) {
+    fprintf(stderr, "soak: %u allocations failed\n", hostHeapFailures());
+    failures++;
+  }
+  if (lowestBlock < options.minBlock) {
+    fprintf(stderr, "soak: largest free block fell to %u bytes (minimum %u)\n", lowestBlock, options.minBlock);
+    failures++;
+  }
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+// Host stand-in for the parts of the ESP8266 Arduino core the sketch uses
+#pragma once
+
+#include <algorithm>
+#include <ctype.h>
+#include <functional>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <strings.h>
+#include <time.h>
+#include <type_traits>
+
+#define PROGMEM
+#define PGM_P const char*
+#define F(x) x
+#define FPSTR(x) x
+
+using std::max;
+using std::min;
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void configTime(const char* tz, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+
+template <typename T, typename L, typename H>
+T constrain(T value, L low, H high) {
+  return value < (T)low ? (T)low : (value > (T)high ? (T)high : value);
+}
+
+// Flash access is plain memory access on the host
+inline void* memcpy_P(void* dest, const void* src, size_t n) { return memcpy(dest, src, n); }
+inline int strcasecmp_P(const char* a, const char* b) { return strcasecmp(a, b); }
+inline int strncasecmp_P(const char* a, const char* b, size_t n) { return strncasecmp(a, b, n); }
+inline size_t strlen_P(const char* s) { return strlen(s); }
+inline char* strncpy_P(char* dest, const char* src, size_t n) { return strncpy(dest, src, n); }
+inline uint8_t pgm_read_byte(const void* p) { return *(const uint8_t*)p; }
+inline uint16_t pgm_read_word(const void* p) { return *(const uint16_t*)p; }
+inline uint32_t pgm_read_dword(const void* p) { return *(const uint32_t*)p; }
+
+class String {
+public:
+  String() {}
+  String(const char* s) : value(s != nullptr ? s : "") {}
+  String(const std::string& s) : value(s) {}
+  String(char c) : value(1, c) {}
+  String(int n, unsigned char base = 10) { fromInteger(n, base); }
+  String(unsigned int n, unsigned char base = 10) { fromInteger(n, base); }
+  String(long n, unsigned char base = 10) { fromInteger(n, base); }
+  String(unsigned long n, unsigned char base = 10) { fromInteger(n, base); }
+
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  bool isEmpty() const { return value.empty(); }
+  bool reserve(unsigned int size) { value.reserve(size); return true; }
+  char operator[](unsigned int i) const { return i < value.size() ? value[i] : 0; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& s) { value += s.value; return *this; }
+  String& operator+=(const char* s) { value += s; return *this; }
+  String& operator+=(char c) { value += c; return *this; }
+  bool concat(const String& s) { value += s.value; return true; }
+  bool concat(const char* s, unsigned int n) { value.append(s, n); return true; }
+  String operator+(const String& s) const { return String(value + s.value); }
+  String operator+(const char* s) const { return String(value + s); }
+
+  bool operator==(const String& s) const { return value == s.value; }
+  bool operator==(const char* s) const { return value == s; }
+  bool operator!=(const String& s) const { return value != s.value; }
+  bool operator!=(const char* s) const { return value != s; }
+  bool equalsIgnoreCase(const String& s) const { return strcasecmp(c_str(), s.c_str()) == 0; }
+
+  long toInt() const { return atol(c_str()); }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t at = value.find(c, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  int indexOf(const char* s, unsigned int from = 0) const {
+    size_t at = value.find(s, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from >= value.size() || to <= from) return String();
+    return String(value.substr(from, to - from));
+  }
+  bool startsWith(const char* s) const { return value.compare(0, strlen(s), s) == 0; }
+  void trim() {
+    size_t start = value.find_first_not_of(" \t\r\n");
+    size_t end = value.find_last_not_of(" \t\r\n");
+    value = start == std::string::npos ? std::string() : value.substr(start, end - start + 1);
+  }
+  void toLowerCase() { for (char& c : value) c = tolower(c); }
+
+  const std::string& str() const { return value; }
+
+private:
+  template <typename T>
+  void fromInteger(T n, unsigned char base) {
+    char buffer[72];
+    if (base == 10) {
+      if (std::is_signed<T>::value) {
+        snprintf(buffer, sizeof(buffer), "%lld", (long long)n);
+      } else {
+        snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)n);
+      }
+    } else {
+      unsigned long long u = (unsigned long long)n;
+      char* p = buffer + sizeof(buffer) - 1;
+      *p = '\0';
+      do {
+        int digit = u % base;
+        *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        u /= base;
+      } while (u > 0);
+      memmove(buffer, p, strlen(p) + 1);
+    }
+    value = buffer;
+  }
+
+  std::string value;
+};
+
+inline String operator+(const char* a, const String& b) { return String(a) + b; }
+
+class Print;
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0 && write(*buffer++) == 1) n++;
+    return n;
+  }
+  size_t write(const char* s) { return s != nullptr ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* s, size_t size) { return write((const uint8_t*)s, size); }
+  virtual void flush() {}
+  virtual int availableForWrite() { return 0; }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = 10) { return printNumber((unsigned long)n, base); }
+  size_t print(int n, int base = 10) { return printSigned(n, base); }
+  size_t print(unsigned int n, int base = 10) { return printNumber(n, base); }
+  size_t print(long n, int base = 10) { return printSigned(n, base); }
+  size_t print(unsigned long n, int base = 10) { return printNumber(n, base); }
+  size_t print(long long n, int base = 10) { return printSigned(n, base); }
+  size_t print(unsigned long long n, int base = 10) { return printNumber(n, base); }
+  size_t print(const Printable& p) { return p.printTo(*this); }
+  size_t print(double n, int digits = 2) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+    return write(buffer);
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) { return print(value) + println(); }
+  template <typename T>
+  size_t println(const T& value, int format) { return print(value, format) + println(); }
+
+  size_t printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return write(buffer);
+  }
+
+private:
+  size_t printSigned(long long n, int base) {
+    if (n < 0 && base == 10) return write((uint8_t)'-') + printNumber((unsigned long long)-n, base);
+    return printNumber((unsigned long long)n, base);
+  }
+  size_t printNumber(unsigned long long n, int base) {
+    char buffer[72];
+    char* p = buffer + sizeof(buffer) - 1;
+    *p = '\0';
+    if (base < 2) base = 10;
+    do {
+      int digit = n % base;
+      *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+      n /= base;
+    } while (n > 0);
+    return write(p);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long ms) { timeoutMs = ms; }
+  size_t readBytes(char* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+      int c = read();
+      if (c < 0) break;
+      buffer[n++] = c;
+    }
+    return n;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+protected:
+  unsigned long timeoutMs = 1000;
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  operator bool() const { return true; }
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int availableForWrite() override; // Room in the 128-byte FIFO, drained at 115200 baud
+};
+
+extern HardwareSerial Serial;
+
+class IPAddress : public Printable {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d; }
+  explicit IPAddress(uint32_t address) { memcpy(bytes, &address, 4); }
+  String toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return String(buffer);
+  }
+  bool fromString(const char* s) {
+    unsigned a, b, c, d;
+    if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) return false;
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+  bool isSet() const { return bytes[0] | bytes[1] | bytes[2] | bytes[3]; }
+  bool operator==(const IPAddress& other) const { return memcmp(bytes, other.bytes, 4) == 0; }
+  bool operator!=(const IPAddress& other) const { return !(*this == other); }
+  uint8_t operator[](int i) const { return bytes[i]; }
+  size_t printTo(Print& p) const override { return p.print(toString()); }
+
+private:
+  uint8_t bytes[4] = {0, 0, 0, 0};
+};
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMaxFreeBlockSize();
+  uint8_t getHeapFragmentation();
+  uint32_t getChipId() { return 0x00c0ffee; }
+  void restart() {}
+};
+
+extern EspClass ESP;
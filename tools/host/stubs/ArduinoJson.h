@@ -0,0 +1,820 @@
+// Host stand-in for the subset of ArduinoJson 7 the sketch uses.
+//
+// The values live in host memory, but every document charges the simulated
+// heap the way ArduinoJson 7 allocates on a 32-bit board: slots come from
+// pools of JSON_POOL_SLOTS that are allocated as the document grows, and
+// each copied string takes a block of its own. A document therefore grows
+// with its input, and parsing fails with NoMemory when the heap runs out.
+// The sizes below approximate the real library; they are not exact.
+#pragma once
+
+#include <Arduino.h>
+#include <errno.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define JSON_SLOT_SIZE 8
+#define JSON_POOL_SLOTS 128
+#define JSON_STRING_HEADER 8
+
+void* hostHeapAllocate(size_t size);
+void hostHeapRelease(void* p);
+bool hostHeapActive();
+void hostHeapSetActive(bool active);
+
+namespace ArduinoJsonHost {
+
+class Pause {
+public:
+  Pause() : previous(hostHeapActive()) { hostHeapSetActive(false); }
+  ~Pause() { hostHeapSetActive(previous); }
+
+private:
+  bool previous;
+};
+
+// What a document has taken from the simulated heap
+struct Pool {
+  std::vector<void*> blocks;
+  size_t slotsLeft = 0;
+  bool metered = false;
+  bool overflowed = false;
+
+  bool takeSlots(size_t n) {
+    if (!metered) return true;
+    Pause pause;
+    while (slotsLeft < n) {
+      if (!takeBlock(JSON_POOL_SLOTS * JSON_SLOT_SIZE)) return false;
+      slotsLeft += JSON_POOL_SLOTS;
+    }
+    slotsLeft -= n;
+    return true;
+  }
+
+  bool takeString(size_t length) {
+    if (!metered) return true;
+    Pause pause;
+    return takeBlock(JSON_STRING_HEADER + length + 1);
+  }
+
+  bool takeBlock(size_t size) {
+    hostHeapSetActive(true);
+    void* block = hostHeapAllocate(size);
+    hostHeapSetActive(false);
+    if (block == nullptr) {
+      overflowed = true;
+      return false;
+    }
+    blocks.push_back(block);
+    return true;
+  }
+
+  void release() {
+    Pause pause;
+    for (void* block : blocks) hostHeapRelease(block);
+    blocks.clear();
+    blocks.shrink_to_fit();
+    slotsLeft = 0;
+    overflowed = false;
+  }
+};
+
+struct Node {
+  enum Type { NUL, BOOL, INT, UINT, FLOAT, STR, ARR, OBJ };
+  Type type = NUL;
+  bool b = false;
+  int64_t i = 0;
+  uint64_t u = 0;
+  double f = 0;
+  std::string s;
+  std::vector<std::string> keys;
+  std::vector<std::unique_ptr<Node>> children;
+
+  Node* find(const char* key) const {
+    if (type != OBJ || key == nullptr) return nullptr;
+    for (size_t n = 0; n < keys.size(); n++) {
+      if (keys[n] == key) return children[n].get();
+    }
+    return nullptr;
+  }
+
+  void reset() {
+    Pause pause;
+    type = NUL;
+    s.clear();
+    keys.clear();
+    children.clear();
+  }
+};
+
+} // namespace ArduinoJsonHost
+
+class JsonArray;
+class JsonObject;
+
+// A value inside a document: either a node, or a key of an object that may
+// not exist yet (created when assigned, as in ArduinoJson)
+class JsonVariant {
+public:
+  JsonVariant() {}
+  JsonVariant(ArduinoJsonHost::Pool* pool, ArduinoJsonHost::Node* node) : pool(pool), node(node) {}
+  JsonVariant(ArduinoJsonHost::Pool* pool, ArduinoJsonHost::Node* parent, const char* key)
+      : pool(pool), parent(parent), key(key) {}
+
+  ArduinoJsonHost::Node* resolve() const {
+    if (node != nullptr) return node;
+    return parent != nullptr ? parent->find(key) : nullptr;
+  }
+
+  bool isNull() const {
+    const ArduinoJsonHost::Node* n = resolve();
+    return n == nullptr || n->type == ArduinoJsonHost::Node::NUL;
+  }
+
+  template <typename T>
+  bool is() const {
+    using namespace ArduinoJsonHost;
+    const Node* n = resolve();
+    if (n == nullptr) return false;
+    if constexpr (std::is_same<T, bool>::value) {
+      return n->type == Node::BOOL;
+    } else if constexpr (std::is_integral<T>::value) {
+      if (n->type == Node::INT) {
+        return n->i >= (int64_t)std::numeric_limits<T>::min() &&
+               (n->i < 0 || (uint64_t)n->i <= (uint64_t)std::numeric_limits<T>::max());
+      }
+      return n->type == Node::UINT && n->u <= (uint64_t)std::numeric_limits<T>::max();
+    } else if constexpr (std::is_floating_point<T>::value) {
+      return n->type == Node::INT || n->type == Node::UINT || n->type == Node::FLOAT;
+    } else if constexpr (std::is_same<T, const char*>::value) {
+      return n->type == Node::STR;
+    } else if constexpr (std::is_same<T, JsonArray>::value) {
+      return n->type == Node::ARR;
+    } else if constexpr (std::is_same<T, JsonObject>::value) {
+      return n->type == Node::OBJ;
+    } else {
+      return false;
+    }
+  }
+
+  template <typename T>
+  T as() const;
+
+  template <typename T>
+  operator T() const { return as<T>(); }
+
+  template <typename T>
+  T operator|(T defaultValue) const { return is<T>() ? as<T>() : defaultValue; }
+  const char* operator|(const char* defaultValue) const {
+    return is<const char*>() ? as<const char*>() : defaultValue;
+  }
+
+  JsonVariant operator[](const char* k) const { return JsonVariant(pool, resolve(), k); }
+  JsonVariant operator[](int index) const {
+    ArduinoJsonHost::Node* n = resolve();
+    if (n == nullptr || n->type != ArduinoJsonHost::Node::ARR || index < 0 ||
+        (size_t)index >= n->children.size()) {
+      return JsonVariant();
+    }
+    return JsonVariant(pool, n->children[index].get());
+  }
+
+  size_t size() const {
+    const ArduinoJsonHost::Node* n = resolve();
+    if (n == nullptr || (n->type != ArduinoJsonHost::Node::ARR && n->type != ArduinoJsonHost::Node::OBJ)) return 0;
+    return n->children.size();
+  }
+
+  template <typename T>
+  JsonVariant& operator=(const T& value) {
+    set(value);
+    return *this;
+  }
+
+  template <typename T>
+  bool set(const T& value);
+
+  // Turns the slot into a container, creating it when needed
+  ArduinoJsonHost::Node* make(ArduinoJsonHost::Node::Type type) const;
+
+  JsonArray createNestedArray(const char* k) const;
+  JsonObject createNestedObject(const char* k) const;
+
+protected:
+  ArduinoJsonHost::Pool* pool = nullptr;
+  ArduinoJsonHost::Node* node = nullptr;
+  ArduinoJsonHost::Node* parent = nullptr;
+  const char* key = nullptr;
+};
+
+class JsonArray {
+public:
+  class iterator {
+  public:
+    iterator(ArduinoJsonHost::Pool* pool, ArduinoJsonHost::Node* node, size_t index)
+        : pool(pool), node(node), index(index) {}
+    JsonVariant operator*() const { return JsonVariant(pool, node->children[index].get()); }
+    iterator& operator++() {
+      index++;
+      return *this;
+    }
+    bool operator!=(const iterator& other) const { return index != other.index; }
+
+  private:
+    ArduinoJsonHost::Pool* pool;
+    ArduinoJsonHost::Node* node;
+    size_t index;
+  };
+
+  JsonArray() {}
+  JsonArray(ArduinoJsonHost::Pool* pool, ArduinoJsonHost::Node* node) : pool(pool), node(node) {}
+
+  bool isNull() const { return node == nullptr; }
+  size_t size() const { return node != nullptr ? node->children.size() : 0; }
+  iterator begin() const { return iterator(pool, node, 0); }
+  iterator end() const { return iterator(pool, node, size()); }
+  JsonVariant operator[](int index) const { return JsonVariant(pool, node).operator[](index); }
+
+  JsonVariant addSlot() const {
+    if (node == nullptr || !pool->takeSlots(1)) return JsonVariant();
+    ArduinoJsonHost::Pause pause;
+    node->children.emplace_back(new ArduinoJsonHost::Node());
+    return JsonVariant(pool, node->children.back().get());
+  }
+
+  template <typename T>
+  bool add(const T& value) const {
+    JsonVariant slot = addSlot();
+    return slot.resolve() != nullptr && slot.set(value);
+  }
+
+  JsonObject createNestedObject() const;
+  JsonArray createNestedArray() const;
+
+private:
+  ArduinoJsonHost::Pool* pool = nullptr;
+  ArduinoJsonHost::Node* node = nullptr;
+};
+
+class JsonObject {
+public:
+  JsonObject() {}
+  JsonObject(ArduinoJsonHost::Pool* pool, ArduinoJsonHost::Node* node) : pool(pool), node(node) {}
+
+  bool isNull() const { return node == nullptr; }
+  size_t size() const { return node != nullptr ? node->children.size() : 0; }
+  bool containsKey(const char* k) const { return node != nullptr && node->find(k) != nullptr; }
+  JsonVariant operator[](const char* k) const { return JsonVariant(pool, node, k); }
+  JsonArray createNestedArray(const char* k) const { return JsonVariant(pool, node, k).createNestedArray(nullptr); }
+  JsonObject createNestedObject(const char* k) const { return JsonVariant(pool, node, k).createNestedObject(nullptr); }
+
+private:
+  ArduinoJsonHost::Pool* pool = nullptr;
+  ArduinoJsonHost::Node* node = nullptr;
+};
+
+inline ArduinoJsonHost::Node* JsonVariant::make(ArduinoJsonHost::Node::Type type) const {
+  using namespace ArduinoJsonHost;
+  Node* n = resolve();
+  if (n == nullptr) {
+    if (parent == nullptr) return nullptr;
+    if (parent->type == Node::NUL) parent->type = Node::OBJ;
+    if (parent->type != Node::OBJ || !pool->takeSlots(1)) return nullptr;
+    Pause pause;
+    parent->keys.push_back(key);
+    parent->children.emplace_back(new Node());
+    n = parent->children.back().get();
+  }
+  if (type == Node::NUL) return n;
+  if (n->type != type) {
+    n->reset();
+    n->type = type;
+  }
+  return n;
+}
+
+template <typename T>
+T JsonVariant::as() const {
+  using namespace ArduinoJsonHost;
+  const Node* n = resolve();
+  if constexpr (std::is_same<T, JsonArray>::value) {
+    return n != nullptr && n->type == Node::ARR ? JsonArray(pool, const_cast<Node*>(n)) : JsonArray();
+  } else if constexpr (std::is_same<T, JsonObject>::value) {
+    return n != nullptr && n->type == Node::OBJ ? JsonObject(pool, const_cast<Node*>(n)) : JsonObject();
+  } else if constexpr (std::is_same<T, JsonVariant>::value) {
+    return *this;
+  } else if constexpr (std::is_same<T, const char*>::value) {
+    return n != nullptr && n->type == Node::STR ? n->s.c_str() : nullptr;
+  } else if constexpr (std::is_same<T, String>::value) {
+    return n != nullptr && n->type == Node::STR ? String(n->s.c_str()) : String();
+  } else if constexpr (std::is_same<T, bool>::value) {
+    if (n == nullptr) return false;
+    if (n->type == Node::BOOL) return n->b;
+    if (n->type == Node::INT) return n->i != 0;
+    if (n->type == Node::UINT) return n->u != 0;
+    if (n->type == Node::FLOAT) return n->f != 0;
+    return false;
+  } else if constexpr (std::is_integral<T>::value) {
+    // Values that do not fit the target type read as 0, as in ArduinoJson
+    if (n == nullptr) return 0;
+    if (n->type == Node::FLOAT) return n->f >= (double)std::numeric_limits<T>::min() &&
+                                       n->f <= (double)std::numeric_limits<T>::max() ? (T)n->f : 0;
+    if (n->type == Node::BOOL) return n->b ? 1 : 0;
+    return is<T>() ? (n->type == Node::INT ? (T)n->i : (T)n->u) : 0;
+  } else if constexpr (std::is_floating_point<T>::value) {
+    if (n == nullptr) return 0;
+    if (n->type == Node::INT) return (T)n->i;
+    if (n->type == Node::UINT) return (T)n->u;
+    if (n->type == Node::FLOAT) return (T)n->f;
+    return 0;
+  } else {
+    static_assert(sizeof(T) == 0, "unsupported conversion");
+  }
+}
+
+template <typename T>
+bool JsonVariant::set(const T& value) {
+  using namespace ArduinoJsonHost;
+  using V = typename std::decay<T>::type;
+  Node* n = make(Node::NUL);
+  if (n == nullptr) return false;
+
+  if constexpr (std::is_same<V, bool>::value) {
+    n->reset();
+    n->type = Node::BOOL;
+    n->b = value;
+  } else if constexpr (std::is_integral<V>::value) {
+    n->reset();
+    if (std::is_signed<V>::value || (uint64_t)value <= (uint64_t)INT64_MAX) {
+      n->type = Node::INT;
+      n->i = (int64_t)value;
+    } else {
+      n->type = Node::UINT;
+      n->u = (uint64_t)value;
+    }
+  } else if constexpr (std::is_floating_point<V>::value) {
+    n->reset();
+    n->type = Node::FLOAT;
+    n->f = value;
+  } else if constexpr (std::is_same<V, const char*>::value || std::is_same<V, char*>::value) {
+    // A string literal is stored by reference in ArduinoJson, so only char*
+    // (which char arrays decay to) and String are charged a copy
+    if (value == nullptr) {
+      n->reset();
+      return true;
+    }
+    if (std::is_same<V, char*>::value && !pool->takeString(strlen(value))) return false;
+    Pause pause;
+    n->reset();
+    n->type = Node::STR;
+    n->s = value;
+  } else if constexpr (std::is_same<V, String>::value) {
+    if (!pool->takeString(value.length())) return false;
+    Pause pause;
+    n->reset();
+    n->type = Node::STR;
+    n->s = value.c_str();
+  } else {
+    static_assert(sizeof(V) == 0, "unsupported value");
+  }
+  return true;
+}
+
+inline JsonArray JsonVariant::createNestedArray(const char* k) const {
+  JsonVariant slot = k != nullptr ? JsonVariant(pool, make(ArduinoJsonHost::Node::OBJ), k) : *this;
+  return JsonArray(pool, slot.make(ArduinoJsonHost::Node::ARR));
+}
+
+inline JsonObject JsonVariant::createNestedObject(const char* k) const {
+  JsonVariant slot = k != nullptr ? JsonVariant(pool, make(ArduinoJsonHost::Node::OBJ), k) : *this;
+  return JsonObject(pool, slot.make(ArduinoJsonHost::Node::OBJ));
+}
+
+inline JsonObject JsonArray::createNestedObject() const {
+  JsonVariant slot = addSlot();
+  return JsonObject(pool, slot.make(ArduinoJsonHost::Node::OBJ));
+}
+
+inline JsonArray JsonArray::createNestedArray() const {
+  JsonVariant slot = addSlot();
+  return JsonArray(pool, slot.make(ArduinoJsonHost::Node::ARR));
+}
+
+class JsonDocument {
+public:
+  JsonDocument() { pool.metered = hostHeapActive(); }
+  ~JsonDocument() { clear(); }
+  JsonDocument(const JsonDocument&) = delete;
+  JsonDocument& operator=(const JsonDocument&) = delete;
+
+  void clear() {
+    root.reset();
+    pool.release();
+  }
+
+  bool overflowed() const { return pool.overflowed; }
+  JsonVariant operator[](const char* k) { return JsonVariant(&pool, &root, k); }
+  bool containsKey(const char* k) const { return root.find(k) != nullptr; }
+  JsonArray createNestedArray(const char* k) { return JsonVariant(&pool, &root).createNestedArray(k); }
+  JsonObject createNestedObject(const char* k) { return JsonVariant(&pool, &root).createNestedObject(k); }
+  template <typename T>
+  T as() { return JsonVariant(&pool, &root).as<T>(); }
+  JsonVariant variant() { return JsonVariant(&pool, &root); }
+
+  ArduinoJsonHost::Pool pool;
+  ArduinoJsonHost::Node root;
+};
+
+// Deprecated in ArduinoJson 7, where the capacity is ignored
+class DynamicJsonDocument : public JsonDocument {
+public:
+  explicit DynamicJsonDocument(size_t) {}
+};
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+
+  DeserializationError(Code code = Ok) : value(code) {}
+  explicit operator bool() const { return value != Ok; }
+  Code code() const { return value; }
+  bool operator==(Code code) const { return value == code; }
+  bool operator!=(Code code) const { return value != code; }
+  const char* c_str() const {
+    static const char* names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+    return names[value];
+  }
+
+private:
+  Code value;
+};
+
+namespace DeserializationOption {
+struct NestingLimit {
+  explicit NestingLimit(uint8_t limit = 10) : value(limit) {}
+  uint8_t value;
+};
+} // namespace DeserializationOption
+
+namespace ArduinoJsonHost {
+
+// Input, read one character at a time like the real parser reads a Stream
+struct Reader {
+  const char* data = nullptr;
+  size_t length = 0;
+  size_t position = 0;
+  Stream* stream = nullptr;
+  int buffered = -2;
+
+  int peek() {
+    if (buffered == -2) buffered = stream != nullptr ? stream->read() : (position < length ? (uint8_t)data[position++] : -1);
+    return buffered;
+  }
+  int read() {
+    int c = peek();
+    buffered = -2;
+    return c;
+  }
+};
+
+class Parser {
+public:
+  Parser(Reader& reader, Pool& pool) : in(reader), pool(pool) {}
+
+  DeserializationError::Code parse(Node& root, uint8_t nestingLimit) {
+    skipSpace();
+    if (in.peek() < 0) return DeserializationError::EmptyInput;
+    return parseValue(root, nestingLimit);
+  }
+
+private:
+  void skipSpace() {
+    while (in.peek() == ' ' || in.peek() == '\t' || in.peek() == '\r' || in.peek() == '\n') in.read();
+  }
+
+  DeserializationError::Code parseValue(Node& node, uint8_t nestingLimit) {
+    skipSpace();
+    int c = in.peek();
+    if (c < 0) return DeserializationError::IncompleteInput;
+    if (c == '{' || c == '[') {
+      if (nestingLimit == 0) return DeserializationError::TooDeep;
+      return c == '{' ? parseObject(node, nestingLimit - 1) : parseArray(node, nestingLimit - 1);
+    }
+    if (c == '"' || c == '\'') {
+      std::string value;
+      DeserializationError::Code error = parseString(value);
+      if (error != DeserializationError::Ok) return error;
+      if (!pool.takeString(value.size())) return DeserializationError::NoMemory;
+      Pause pause;
+      node.type = Node::STR;
+      node.s = std::move(value);
+      return DeserializationError::Ok;
+    }
+    return parseScalar(node);
+  }
+
+  DeserializationError::Code parseObject(Node& node, uint8_t nestingLimit) {
+    in.read();
+    node.type = Node::OBJ;
+    skipSpace();
+    if (in.peek() == '}') {
+      in.read();
+      return DeserializationError::Ok;
+    }
+
+    while (true) {
+      skipSpace();
+      if (in.peek() < 0) return DeserializationError::IncompleteInput;
+      if (in.peek() != '"' && in.peek() != '\'') return DeserializationError::InvalidInput;
+      std::string key;
+      DeserializationError::Code error = parseString(key);
+      if (error != DeserializationError::Ok) return error;
+      skipSpace();
+      int c = in.read();
+      if (c < 0) return DeserializationError::IncompleteInput;
+      if (c != ':') return DeserializationError::InvalidInput;
+
+      if (!pool.takeSlots(1) || !pool.takeString(key.size())) return DeserializationError::NoMemory;
+      Node* child;
+      {
+        Pause pause;
+        Node* existing = node.find(key.c_str());
+        if (existing != nullptr) {
+          existing->reset();
+          child = existing;
+        } else {
+          node.keys.push_back(key);
+          node.children.emplace_back(new Node());
+          child = node.children.back().get();
+        }
+      }
+      error = parseValue(*child, nestingLimit);
+      if (error != DeserializationError::Ok) return error;
+
+      skipSpace();
+      c = in.read();
+      if (c < 0) return DeserializationError::IncompleteInput;
+      if (c == '}') return DeserializationError::Ok;
+      if (c != ',') return DeserializationError::InvalidInput;
+    }
+  }
+
+  DeserializationError::Code parseArray(Node& node, uint8_t nestingLimit) {
+    in.read();
+    node.type = Node::ARR;
+    skipSpace();
+    if (in.peek() == ']') {
+      in.read();
+      return DeserializationError::Ok;
+    }
+
+    while (true) {
+      if (!pool.takeSlots(1)) return DeserializationError::NoMemory;
+      Node* child;
+      {
+        Pause pause;
+        node.children.emplace_back(new Node());
+        child = node.children.back().get();
+      }
+      DeserializationError::Code error = parseValue(*child, nestingLimit);
+      if (error != DeserializationError::Ok) return error;
+
+      skipSpace();
+      int c = in.read();
+      if (c < 0) return DeserializationError::IncompleteInput;
+      if (c == ']') return DeserializationError::Ok;
+      if (c != ',') return DeserializationError::InvalidInput;
+    }
+  }
+
+  DeserializationError::Code parseString(std::string& value) {
+    Pause pause;
+    int quote = in.read();
+    while (true) {
+      int c = in.read();
+      if (c < 0) return DeserializationError::IncompleteInput;
+      if (c == quote) return DeserializationError::Ok;
+      if (c == '\\') {
+        c = in.read();
+        if (c < 0) return DeserializationError::IncompleteInput;
+        switch (c) {
+          case 'b': c = '\b'; break;
+          case 'f': c = '\f'; break;
+          case 'n': c = '\n'; break;
+          case 'r': c = '\r'; break;
+          case 't': c = '\t'; break;
+          case 'u': {
+            unsigned codepoint = 0;
+            for (int k = 0; k < 4; k++) {
+              int h = in.read();
+              if (h < 0) return DeserializationError::IncompleteInput;
+              if (!isxdigit(h)) return DeserializationError::InvalidInput;
+              codepoint = codepoint * 16 + (isdigit(h) ? h - '0' : (tolower(h) - 'a' + 10));
+            }
+            if (codepoint < 0x80) {
+              value += (char)codepoint;
+            } else if (codepoint < 0x800) {
+              value += (char)(0xC0 | (codepoint >> 6));
+              value += (char)(0x80 | (codepoint & 0x3F));
+            } else {
+              value += (char)(0xE0 | (codepoint >> 12));
+              value += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+              value += (char)(0x80 | (codepoint & 0x3F));
+            }
+            continue;
+          }
+          case '"': case '\'': case '\\': case '/': break;
+          default: return DeserializationError::InvalidInput;
+        }
+      } else if (c < 0x20) {
+        return DeserializationError::InvalidInput;
+      }
+      value += (char)c;
+    }
+  }
+
+  DeserializationError::Code parseScalar(Node& node) {
+    char token[64];
+    size_t used = 0;
+    while (true) {
+      int c = in.peek();
+      if (c < 0 || !(isalnum(c) || c == '-' || c == '+' || c == '.')) break;
+      if (used >= sizeof(token) - 1) return DeserializationError::InvalidInput;
+      token[used++] = in.read();
+    }
+    token[used] = '\0';
+    if (used == 0) return DeserializationError::InvalidInput;
+
+    if (strcmp(token, "true") == 0 || strcmp(token, "false") == 0) {
+      node.type = Node::BOOL;
+      node.b = token[0] == 't';
+      return DeserializationError::Ok;
+    }
+    if (strcmp(token, "null") == 0) return DeserializationError::Ok;
+
+    char* end;
+    bool integer = strpbrk(token, ".eE") == nullptr;
+    if (integer && token[0] != '-') {
+      errno = 0;
+      unsigned long long u = strtoull(token, &end, 10);
+      if (*end == '\0' && errno == 0) {
+        if (u <= (unsigned long long)INT64_MAX) {
+          node.type = Node::INT;
+          node.i = (int64_t)u;
+        } else {
+          node.type = Node::UINT;
+          node.u = u;
+        }
+        return DeserializationError::Ok;
+      }
+    } else if (integer) {
+      errno = 0;
+      long long i = strtoll(token, &end, 10);
+      if (*end == '\0' && errno == 0) {
+        node.type = Node::INT;
+        node.i = i;
+        return DeserializationError::Ok;
+      }
+    }
+    double f = strtod(token, &end);
+    if (*end != '\0') return DeserializationError::InvalidInput;
+    node.type = Node::FLOAT;
+    node.f = f;
+    return DeserializationError::Ok;
+  }
+
+  Reader& in;
+  Pool& pool;
+};
+
+inline DeserializationError deserialize(JsonDocument& doc, Reader& reader, uint8_t nestingLimit) {
+  doc.clear();
+  Parser parser(reader, doc.pool);
+  DeserializationError::Code error = parser.parse(doc.root, nestingLimit);
+  if (error != DeserializationError::Ok) doc.clear();
+  return error;
+}
+
+inline void writeString(Print& out, const std::string& s) {
+  out.write('"');
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"': out.write("\\\""); break;
+      case '\\': out.write("\\\\"); break;
+      case '\b': out.write("\\b"); break;
+      case '\f': out.write("\\f"); break;
+      case '\n': out.write("\\n"); break;
+      case '\r': out.write("\\r"); break;
+      case '\t': out.write("\\t"); break;
+      default:
+        if (c < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out.write(escaped);
+        } else {
+          out.write(c);
+        }
+    }
+  }
+  out.write('"');
+}
+
+inline void writeNode(Print& out, const Node& node) {
+  char number[32];
+  switch (node.type) {
+    case Node::NUL: out.write("null"); break;
+    case Node::BOOL: out.write(node.b ? "true" : "false"); break;
+    case Node::INT: snprintf(number, sizeof(number), "%lld", (long long)node.i); out.write(number); break;
+    case Node::UINT: snprintf(number, sizeof(number), "%llu", (unsigned long long)node.u); out.write(number); break;
+    case Node::FLOAT: snprintf(number, sizeof(number), "%.9g", node.f); out.write(number); break;
+    case Node::STR: writeString(out, node.s); break;
+    case Node::ARR:
+      out.write('[');
+      for (size_t n = 0; n < node.children.size(); n++) {
+        if (n > 0) out.write(',');
+        writeNode(out, *node.children[n]);
+      }
+      out.write(']');
+      break;
+    case Node::OBJ:
+      out.write('{');
+      for (size_t n = 0; n < node.children.size(); n++) {
+        if (n > 0) out.write(',');
+        writeString(out, node.keys[n]);
+        out.write(':');
+        writeNode(out, *node.children[n]);
+      }
+      out.write('}');
+      break;
+  }
+}
+
+class StringWriter : public Print {
+public:
+  explicit StringWriter(String& target) : target(target) {}
+  size_t write(uint8_t c) override {
+    target += (char)c;
+    return 1;
+  }
+  using Print::write;
+
+private:
+  String& target;
+};
+
+class CountingWriter : public Print {
+public:
+  size_t write(uint8_t) override { return ++count, 1; }
+  using Print::write;
+  size_t count = 0;
+};
+
+} // namespace ArduinoJsonHost
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input,
+                                            DeserializationOption::NestingLimit limit = DeserializationOption::NestingLimit()) {
+  ArduinoJsonHost::Reader reader;
+  reader.data = input != nullptr ? input : "";
+  reader.length = strlen(reader.data);
+  return ArduinoJsonHost::deserialize(doc, reader, limit.value);
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length,
+                                            DeserializationOption::NestingLimit limit = DeserializationOption::NestingLimit()) {
+  ArduinoJsonHost::Reader reader;
+  reader.data = input;
+  reader.length = length;
+  return ArduinoJsonHost::deserialize(doc, reader, limit.value);
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input,
+                                            DeserializationOption::NestingLimit limit = DeserializationOption::NestingLimit()) {
+  return deserializeJson(doc, input.c_str(), (size_t)input.length(), limit);
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, Stream& input,
+                                            DeserializationOption::NestingLimit limit = DeserializationOption::NestingLimit()) {
+  ArduinoJsonHost::Reader reader;
+  reader.stream = &input;
+  return ArduinoJsonHost::deserialize(doc, reader, limit.value);
+}
+
+inline size_t serializeJson(const JsonDocument& doc, Print& out) {
+  ArduinoJsonHost::CountingWriter counter;
+  ArduinoJsonHost::writeNode(counter, doc.root);
+  ArduinoJsonHost::writeNode(out, doc.root);
+  return counter.count;
+}
+
+inline size_t serializeJson(const JsonDocument& doc, String& out) {
+  ArduinoJsonHost::StringWriter writer(out);
+  return serializeJson(doc, writer);
+}
+
+inline size_t measureJson(const JsonDocument& doc) {
+  ArduinoJsonHost::CountingWriter counter;
+  ArduinoJsonHost::writeNode(counter, doc.root);
+  return counter.count;
+}
@@ -0,0 +1,96 @@
+// Host stand-in for ESP8266WebServer. Requests come either straight from the
+// harness (hostRequest) or, once hostServeOn() has been called, from a real
+// socket on a loopback address. Like the real server, the request body is
+// held in the "plain" argument unless the route has a raw handler, in which
+// case it is streamed through raw() in HTTP_RAW_BUFLEN pieces.
+//
+// Socket clients are handled as in core 3.1.2: one at a time, with a
+// keep-alive connection held between requests until another connection is
+// waiting or it has been idle for HTTP_MAX_CLOSE_WAIT.
+#pragma once
+
+#include <ESP8266WiFi.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+#define HTTP_RAW_BUFLEN 1460
+#define HTTP_MAX_ARGS 8
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define HTTP_MAX_DATA_WAIT 5000 // ms to wait for the client to send the request
+#define HTTP_MAX_DATA_AVAILABLE_WAIT 30 // ...when another client is waiting
+#define HTTP_MAX_CLOSE_WAIT 2000 // ms a kept-alive client may stay idle
+
+struct HTTPRaw {
+  HTTPRawStatus status;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_RAW_BUFLEN];
+};
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit ESP8266WebServer(int port);
+
+  void on(const char* uri, HTTPMethod method, THandlerFunction fn);
+  void on(const char* uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+  void onNotFound(THandlerFunction fn) { notFound = fn; }
+  void begin();
+  void handleClient();
+  void keepAlive(bool keepAlive) { keepAliveEnabled = keepAlive; }
+
+  bool hasArg(const char* name) const;
+  const String& arg(const char* name) const;
+  size_t clientContentLength() const { return contentLength; }
+  HTTPRaw& raw() { return *currentRaw; }
+
+  void send(int code, const char* contentType, const String& content) { send(code, contentType, content.c_str()); }
+  void send(int code, const char* contentType, const char* content);
+  void sendHeader(const char*, const char*, bool = false) {}
+  void setContentLength(size_t) {}
+  void sendContent(const char* content, size_t size);
+  void sendContent(const char* content) { sendContent(content, strlen(content)); }
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+
+  // Harness side
+  int dispatch(HTTPMethod method, const std::string& target, const std::string& body);
+  void serveOn(const char* address, uint16_t port);
+  const std::string& response() const { return responseBody; }
+
+private:
+  struct Route {
+    const char* uri;
+    HTTPMethod method;
+    THandlerFunction fn;
+    THandlerFunction ufn;
+    Route* next;
+  };
+
+  enum ClientState { CLIENT_NONE, CLIENT_WAIT_READ, CLIENT_WAIT_CLOSE };
+
+  void clearArgs();
+  bool serveOne(int fd);
+  bool hasPendingClient() const;
+
+  Route* routes = nullptr;
+  THandlerFunction notFound;
+  String* argNames[HTTP_MAX_ARGS] = {nullptr};
+  String* argValues[HTTP_MAX_ARGS] = {nullptr};
+  int argCount = 0;
+  size_t contentLength = 0;
+  HTTPRaw* currentRaw = nullptr;
+  int responseStatus = 0;
+  std::string responseBody;
+  std::string listenAddress;
+  uint16_t listenPort = 0;
+  int listenFd = -1;
+  int clientFd = -1;
+  ClientState clientState = CLIENT_NONE;
+  unsigned long clientStateAt = 0;
+  bool keepAliveEnabled = false;
+};
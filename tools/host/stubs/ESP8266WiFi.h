@@ -0,0 +1,48 @@
+// Host stand-in for the ESP8266 WiFi library. WiFiClient is a real TCP
+// socket, so nodes on loopback addresses can talk to each other.
+#pragma once
+
+#include <Arduino.h>
+
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+#define WIFI_STA 1
+
+class WiFiClass {
+public:
+  void begin(const char*, const char*) {}
+  void mode(int) {}
+  void setAutoReconnect(bool) {}
+  wl_status_t status();
+  bool isConnected() { return status() == WL_CONNECTED; }
+  String SSID() { return String("host"); }
+  IPAddress localIP();
+  bool hostname(const char* name);
+  String hostname();
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+public:
+  WiFiClient() {}
+  ~WiFiClient() { stop(); }
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+
+  // Waits at most the stream timeout for the connection, like the core
+  int connect(IPAddress ip, uint16_t port);
+  uint8_t connected();
+  void stop();
+  void setNoDelay(bool) {}
+  operator bool() { return connected(); }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+
+private:
+  int fd = -1;
+};
@@ -0,0 +1,58 @@
+// Host stand-in for LEAmDNS. The nodes a service query finds are the ones
+// the harness announces with hostMdnsAnnounce(); answers are delivered from
+// update(), as on the board.
+#pragma once
+
+#include <ESP8266WiFi.h>
+#include <functional>
+#include <vector>
+
+struct HostMdnsNode;
+struct HostMdnsService;
+
+class MDNSResponder {
+public:
+  typedef const void* hMDNSService;
+  typedef const void* hMDNSServiceQuery;
+  typedef const void* hMDNSTxt;
+
+  enum class AnswerType : uint32_t {
+    Unknown = 0,
+    ServiceDomain = 1,
+    HostDomainAndPort = 2,
+    Txt = 4,
+    IP4Address = 8,
+  };
+
+  class MDNSServiceInfo {
+  public:
+    explicit MDNSServiceInfo(const HostMdnsNode* node) : node(node) {}
+    const char* serviceDomain();
+    bool hostDomainAvailable() { return true; }
+    const char* hostDomain();
+    bool hostPortAvailable();
+    uint16_t hostPort();
+    bool IP4AddressAvailable();
+    std::vector<IPAddress> IP4Adresses();
+    bool txtAvailable() { return true; }
+    const char* value(const char* key);
+
+  private:
+    const HostMdnsNode* node;
+  };
+
+  typedef std::function<void(MDNSServiceInfo, AnswerType, bool)> MDNSServiceQueryCallbackFunc;
+  typedef std::function<void(const hMDNSService)> MDNSDynamicServiceTxtCallbackFunc;
+
+  bool begin(const char* hostname);
+  bool update();
+  bool announce();
+  hMDNSService addService(const char* name, const char* service, const char* protocol, uint16_t port);
+  hMDNSTxt addServiceTxt(hMDNSService service, const char* key, const char* value);
+  hMDNSTxt addDynamicServiceTxt(hMDNSService service, const char* key, uint32_t value);
+  bool setDynamicServiceTxtCallback(hMDNSService service, MDNSDynamicServiceTxtCallbackFunc callback);
+  hMDNSServiceQuery installServiceQuery(const char* service, const char* protocol, MDNSServiceQueryCallbackFunc callback);
+  bool removeServiceQuery(hMDNSServiceQuery query);
+};
+
+extern MDNSResponder MDNS;
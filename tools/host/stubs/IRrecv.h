@@ -0,0 +1,30 @@
+// Host stand-in for IRrecv: decode() returns captures injected by the harness
+#pragma once
+
+#include <IRremoteESP8266.h>
+
+class decode_results {
+public:
+  decode_type_t decode_type = UNKNOWN;
+  uint64_t value = 0;
+  uint32_t address = 0;
+  uint32_t command = 0;
+  uint16_t bits = 0;
+  volatile uint16_t* rawbuf = nullptr;
+  uint16_t rawlen = 0;
+  bool overflow = false;
+  bool repeat = false;
+};
+
+class IRrecv {
+public:
+  IRrecv(uint16_t pin, uint16_t bufferSize, uint8_t timeout, bool saveBuffer);
+  void enableIRIn();
+  void disableIRIn() {}
+  bool decode(decode_results* results);
+  void resume();
+
+private:
+  uint16_t bufferSize;
+  uint16_t* rawbuf = nullptr;
+};
@@ -0,0 +1,22 @@
+// Host stand-in for the IRremoteESP8266 protocol list
+#pragma once
+
+#include <Arduino.h>
+
+enum decode_type_t {
+  UNKNOWN = -1,
+  UNUSED = 0,
+  RC5,
+  RC6,
+  NEC,
+  SONY,
+  PANASONIC,
+  JVC,
+  SAMSUNG,
+  LG = 10,
+  COOLIX = 15,
+  NEC_LIKE = 26,
+  LG2 = 48,
+};
+
+const uint16_t kRawTick = 2;
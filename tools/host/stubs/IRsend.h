@@ -0,0 +1,16 @@
+// Host stand-in for IRsend: counts frames and advances the clock by the time
+// a frame takes on air
+#pragma once
+
+#include <IRremoteESP8266.h>
+
+class IRsend {
+public:
+  explicit IRsend(uint16_t pin, bool inverted = false, bool modulation = true) : pin(pin) {}
+  void begin() {}
+  void sendRaw(const uint16_t* buffer, uint16_t length, uint16_t frequency);
+  bool send(decode_type_t type, uint64_t value, uint16_t bits, uint16_t repeat = 0);
+
+private:
+  uint16_t pin;
+};
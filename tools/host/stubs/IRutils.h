@@ -0,0 +1,10 @@
+// Host stand-in for the IRremoteESP8266 helpers the sketch uses
+#pragma once
+
+#include <IRrecv.h>
+
+uint16_t getCorrectedRawLength(const decode_results* results);
+uint16_t* resultToRawArray(const decode_results* results);
+String typeToString(decode_type_t protocol, bool isRepeat = false);
+decode_type_t strToDecodeType(const char* name);
+String uint64ToString(uint64_t value, uint8_t base = 10);
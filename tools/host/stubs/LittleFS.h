@@ -0,0 +1,43 @@
+// Host stand-in for LittleFS: files live in memory, with a capacity limit so
+// a full flash can be simulated
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+struct HostFileImpl;
+
+class File : public Stream {
+public:
+  File() {}
+  explicit File(std::shared_ptr<HostFileImpl> impl) : impl(impl) {}
+
+  operator bool() const { return impl != nullptr; }
+  void close();
+  size_t size() const;
+  size_t position() const;
+  bool seek(uint32_t position);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+
+private:
+  std::shared_ptr<HostFileImpl> impl;
+};
+
+class FS {
+public:
+  bool begin() { return true; }
+  bool format();
+  bool exists(const char* path);
+  File open(const char* path, const char* mode);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+};
+
+extern FS LittleFS;
@@ -0,0 +1,3 @@
+// Host build credentials; the board's own file is not part of the repository
+#define WIFI_SSID "host"
+#define WIFI_PASSWD "host"
@@ -0,0 +1,230 @@
+// Throughput test: the sketch is served in its own process on 127.0.0.6,
+// and N client threads each hold one keep-alive connection, as several
+// phones with the page open would. Each client lists the remotes every
+// --think-ms and sends a button once a second. For each N it prints
+// requests per second, latency, and how many connections the clients had
+// to open, which shows how much of keep-alive survives concurrent clients
+// on a server that handles one client at a time.
+//
+//   build/throughput [--seconds S] [--max-clients N] [--think-ms MS]
+//
+// With --think-ms 0 a client always has its next request waiting, and the
+// core keeps serving it while the others wait.
+#include <Arduino.h>
+
+#include "host.h"
+
+#include <arpa/inet.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const char ADDRESS[] = "127.0.0.6";
+const uint16_t PORT = 18081;
+const int REPLY_TIMEOUT_MS = 10000; // Generous: a waiting client queues behind the others
+const int SEND_INTERVAL_MS = 1000;
+
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+  printf("%s %s\n", condition ? "ok  " : "FAIL", what);
+  if (!condition) failures++;
+}
+
+[[noreturn]] void runNode() {
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+  hostSerialEcho(false);
+  hostSetLocalIP(ADDRESS);
+  hostServeOn(ADDRESS, PORT);
+  hostRealTime(true);
+  setup();
+  // Gives the sample remote's "Power" button a signal to send
+  hostRequest(HOST_POST, "/api/record/start", "{\"remoteId\":0,\"buttonId\":0}");
+  hostInjectCapture({9000, 4500, 560, 1690, 560, 560, 560, 1690, 560, 560, 560});
+  loop();
+  while (true) loop();
+}
+
+int connectToNode() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in remote = {};
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons(PORT);
+  inet_pton(AF_INET, ADDRESS, &remote.sin_addr);
+  if (connect(fd, (sockaddr*)&remote, sizeof(remote)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool receiveSome(int fd, std::string& data) {
+  pollfd waiting = {fd, POLLIN, 0};
+  if (poll(&waiting, 1, REPLY_TIMEOUT_MS) != 1) return false;
+  char buffer[1024];
+  ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+  if (n <= 0) return false;
+  data.append(buffer, n);
+  return true;
+}
+
+// Sends one request and reads its reply; returns the status, or 0 when the
+// connection was closed before a whole reply arrived
+int exchange(int fd, const std::string& request, bool& serverCloses) {
+  if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) return 0;
+
+  std::string reply;
+  size_t headerEnd;
+  while ((headerEnd = reply.find("\r\n\r\n")) == std::string::npos) {
+    if (!receiveSome(fd, reply)) return 0;
+  }
+  size_t at = reply.find("Content-Length: ");
+  size_t wanted = at != std::string::npos ? strtoul(reply.c_str() + at + 16, nullptr, 10) : 0;
+  while (reply.size() < headerEnd + 4 + wanted) {
+    if (!receiveSome(fd, reply)) return 0;
+  }
+  serverCloses = reply.find("Connection: close") != std::string::npos;
+  return atoi(reply.c_str() + 9);
+}
+
+struct ClientStats {
+  unsigned long requests = 0;
+  unsigned long connections = 0;
+  unsigned long retries = 0; // Requests resent after the server dropped the connection
+  unsigned long errors = 0; // Requests that got no reply at all
+  std::map<int, unsigned long> statuses;
+  std::vector<double> latenciesMs;
+};
+
+void runClient(std::chrono::steady_clock::time_point until, int thinkMs, ClientStats& stats) {
+  const std::string list = "GET /api/remotes HTTP/1.1\r\nHost: node\r\n\r\n";
+  const std::string body = "{\"remoteId\":0,\"buttonId\":0}";
+  const std::string sendSignal = "POST /api/signal/send HTTP/1.1\r\nHost: node\r\nContent-Type: application/json\r\n"
+                                 "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  int fd = -1;
+  auto sentAt = std::chrono::steady_clock::now();
+
+  while (std::chrono::steady_clock::now() < until) {
+    auto startedAt = std::chrono::steady_clock::now();
+    bool sending = startedAt - sentAt >= std::chrono::milliseconds(SEND_INTERVAL_MS);
+    if (sending) sentAt = startedAt;
+    int status = 0;
+    for (int attempt = 0; attempt < 3 && status == 0; attempt++) {
+      if (fd < 0) {
+        fd = connectToNode();
+        if (fd < 0) continue;
+        stats.connections++;
+      }
+      bool serverCloses = false;
+      status = exchange(fd, sending ? sendSignal : list, serverCloses);
+      if (status == 0 || serverCloses) {
+        close(fd);
+        fd = -1;
+      }
+      if (status == 0) stats.retries++;
+    }
+
+    stats.requests++;
+    if (status == 0) {
+      stats.errors++;
+      continue;
+    }
+    stats.statuses[status]++;
+    stats.latenciesMs.push_back(
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startedAt).count());
+    if (thinkMs > 0) usleep(thinkMs * 1000);
+  }
+  if (fd >= 0) close(fd);
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+  return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 2;
+  int maxClients = 8;
+  int thinkMs = 10;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string flag = argv[i];
+    if (flag == "--seconds") seconds = atof(argv[i + 1]);
+    else if (flag == "--max-clients") maxClients = std::max(1, atoi(argv[i + 1]));
+    else if (flag == "--think-ms") thinkMs = std::max(0, atoi(argv[i + 1]));
+    else {
+      fprintf(stderr, "usage: %s [--seconds S] [--max-clients N] [--think-ms MS]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (argc % 2 == 0) {
+    fprintf(stderr, "usage: %s [--seconds S] [--max-clients N] [--think-ms MS]\n", argv[0]);
+    return 2;
+  }
+
+  pid_t node = fork();
+  if (node == 0) runNode();
+
+  bool serving = false;
+  for (int i = 0; i < 200 && !serving; i++) {
+    int fd = connectToNode();
+    serving = fd >= 0;
+    if (fd >= 0) close(fd);
+    else usleep(20000);
+  }
+  expect(serving, "node is serving");
+  usleep(100000);
+
+  printf("clients,requests,req_per_s,p50_ms,p99_ms,max_ms,connections,retries,errors,status_200,status_503\n");
+  std::vector<ClientStats> results;
+  for (int clients = 1; serving && clients <= maxClients; clients *= 2) {
+    std::vector<ClientStats> stats(clients);
+    std::vector<std::thread> threads;
+    auto until = std::chrono::steady_clock::now() +
+                 std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    for (int i = 0; i < clients; i++) threads.emplace_back(runClient, until, thinkMs, std::ref(stats[i]));
+    for (std::thread& thread : threads) thread.join();
+
+    ClientStats total;
+    bool everyClientServed = true;
+    for (const ClientStats& client : stats) {
+      total.requests += client.requests;
+      total.connections += client.connections;
+      total.retries += client.retries;
+      total.errors += client.errors;
+      for (const auto& status : client.statuses) total.statuses[status.first] += status.second;
+      total.latenciesMs.insert(total.latenciesMs.end(), client.latenciesMs.begin(), client.latenciesMs.end());
+      everyClientServed = everyClientServed && client.latenciesMs.size() > 0;
+    }
+    std::sort(total.latenciesMs.begin(), total.latenciesMs.end());
+    printf("%d,%lu,%.0f,%.1f,%.1f,%.1f,%lu,%lu,%lu,%lu,%lu\n", clients, total.requests,
+           total.latenciesMs.size() / seconds, percentile(total.latenciesMs, 0.5), percentile(total.latenciesMs, 0.99),
+           total.latenciesMs.empty() ? 0 : total.latenciesMs.back(), total.connections, total.retries, total.errors,
+           total.statuses[200], total.statuses[503]);
+    fflush(stdout);
+
+    if (clients == 1) expect(total.connections == 1, "a single client keeps one connection alive");
+    expect(total.errors == 0, "every request was answered");
+    expect(everyClientServed, "every client was served");
+    results.push_back(total);
+
+    // Let queued frames go out before the next round
+    usleep(500000);
+  }
+
+  kill(node, SIGTERM);
+  waitpid(node, nullptr, 0);
+
+  printf("%s\n", failures == 0 ? "throughput: all checks passed" : "throughput: checks failed");
+  return failures == 0 ? 0 : 1;
+}